@@ -8,9 +8,28 @@
 /*********************************************************************************************/
 
 /**************************** Specify the chip that we are using *****************************/
-#include <p18cxxx.h>
+#include "hal.h"
 #include <math.h>
 #include <stdlib.h>
+#include "usart.h"
+#include "lcd.h"
+#include "fmt.h"
+#include "isrprof.h"
+#include "median.h"
+#include "btframe.h"
+#include "adcscan.h"
+#include "pantompkins.h"
+#include "dsp.h"
+#include "ecgsynth.h"
+#include "pipeline.h"
+#include "filter.h"
+#include "command.h"
+#include "rate.h"
+#include "ppg.h"
+#include "eelog.h"
+#include "sched.h"
+#include "timebase.h"
+#include "idle.h"
 
 /************************* Configure the Microcontroller PIC18f4525 **************************/
 #pragma config OSC = XT
@@ -25,104 +44,93 @@
 #pragma config DEBUG = OFF
 #pragma config LVP = OFF
 #pragma config STVREN = OFF
-#define _XTAL_FREQ 4000000
+                                // _XTAL_FREQ: see rate.h
 
 /******************************** Define Prototype Functions *********************************/
-unsigned char ReadADC();
-void Delay_ms(unsigned int x);
-void Transmit(unsigned char value);
-void TransmitBT(unsigned char value);
-void PrintNum(unsigned char value1, unsigned char position1);
 void SetupBluetooth();
-void SetupSerial();
-void SetupADC(unsigned char channel);
 void ClearScreen();
 void Backlight(unsigned char state);
 void SetPosition(unsigned char position);
 void PrintLine(const unsigned char *string, unsigned char numChars);
-void PrintInt(int value, unsigned char position);
+void FunctionSetup();
+void FilterBlock(unsigned char fn, const unsigned char *x);
+void RunCommand(unsigned char code);
+void SaveSettings();
+void LogBeat(unsigned char fn, unsigned char bpm);
+void LogFaults();
+void Blocks();
+void Commands();
+void Redraw();
+void Readout();
+void Counter();
 void interrupt isr(void);
 
 /************************************** Global variables *************************************/
-unsigned char function, functionBT, mode, update, debounce0, debounce1, debounce2;
-unsigned char LEDcount, output, output1, output2, counter, counter1, skipCount;
-unsigned char data0, data1, data2, array[9], rank[9], do_MOBD, refractory, display;
-unsigned char temp, sampling[16], TMRcntH[16], TMRcntL[16], sampling_H, sampling_L;
+unsigned char function, functionBT, debounce0, debounce1, debounce2;
+unsigned char LEDcount, output, output1, output2, counter, counter1;
+unsigned char do_MOBD, display;
+unsigned char temp;
 unsigned char enableBT; // BLUETOOTH
-int i, j, dummy, d0, d1, d2, mobd, threshold, rri_count, hr;
-
-unsigned char ReadADC() { /************* start A/D, read from an A/D channel *****************/
-    unsigned char ADC_VALUE;
-    ADCON0bits.GO = 1;				// Start the AD conversion
-    while(!PIR1bits.ADIF) continue;	// Wait until AD conversion is complete
-    ADC_VALUE = ADRESH;				// Return the highest 8 bits of the 10-bit AD conversion
-    return ADC_VALUE;
-}
-
-void Delay_ms(unsigned int x){ 	/****** Generate a delay for x ms, assuming 4 MHz clock ******/
-    unsigned char y;
-    for(;x > 0; x--) for(y=0; y< 82;y++);
-}
-
-void Transmit(unsigned char value) {  /********** send an ASCII Character to USART ***********/
-    while(!PIR1bits.TXIF) continue;		// Wait until USART is ready
-    TXREG = value;						// Send the data
-    while (!PIR1bits.TXIF) continue;	// Wait until USART is ready
-    Delay_ms(4); // Give the LCD some time to listen to what we've got to say.
-}
-
-void TransmitBT(unsigned char value) {  /********* send an ASCII Character to USART **********/
-    while(!PIR1bits.TXIF) continue;		// Wait until USART is ready
-    TXREG = value;						// Send the data
-    while (!PIR1bits.TXIF) continue;	// Wait until USART is ready
-}
-
-void PrintNum(unsigned char value1, unsigned char position1){ /** Print number at position ***/
-    int units, tens, hundreds, thousands;
-    SetPosition(position1);			// Set at the present position
-    hundreds = value1 / 100;		// Get the hundreds digit, convert to ASCII and send
-    if (hundreds != 0) Transmit(hundreds + 48);
-    else Transmit(20);
-    value1 = value1 - hundreds * 100;
-    tens = value1 / 10;				// Get the tens digit, convert to ASCII and send
-    Transmit(tens + 48);
-    units = value1 - tens * 10;
-    Transmit(units + 48);			// Convert to ASCII and send
-}
+unsigned char lastFunction;     // Function of the previous TMR0 tick
+unsigned char ecgShown;         // Rate on the LCD for function 1
+unsigned char rate_H, rate_L;   // TMR0 reload of the block-processed functions
+unsigned int rateHz;            // Their sampling rate, 0 for the other functions
+unsigned char blockFunction;    // Function of the last block FilterBlock() processed
+unsigned char filterSel;        // Coefficient set of functions 4-7, see filter.h
+int d0, d1, d2, hr;
+const unsigned char scan_set[13] = {	// A/D channels each function converts per tick
+    0, SCAN_AN2, SCAN_AN0, SCAN_AN0 | SCAN_AN2, SCAN_AN0, SCAN_AN0, SCAN_AN0, SCAN_AN0, SCAN_AN0,
+    SCAN_AN1, SCAN_AN3, SCAN_AN1 | SCAN_AN3, SCAN_AN1 };
+unsigned char beat[3 + 2 * RR_HIST];    // QRS record for the Bluetooth stream
+unsigned char pulse[11];                // PPG pulse record, see ppg.h
+long ratio;                             // SpO2 ratio R x 100 of the last pulse
+#define HR_LOG_BEATS    64      // Beats per EE_EV_HR record, about a minute
+unsigned char eeRec[EE_SLOT];           // EEPROM record, see eelog.h
+unsigned char hrMin, hrMax, hrCount;    // Heart rate over the beats of the next EE_EV_HR
+unsigned int hrSum, hrBeats;            // and beats since the function was entered
+unsigned char faults[6];                // Fault counters in the last EE_EV_FAULT
+unsigned char taskBlocks, taskCommands, taskRedraw;    // Posted tasks, see sched.h
+unsigned char btWait;                   // SetupBluetooth(): stream off until btReady
+unsigned long btReady;                  // TimeUs() deadline, see timebase.h
+#define BT_SETTLE_MS    500     // Bluetooth module settling after the baud rate change
+#define COUNT_TICKS     5       // Function 0: one count per 5 ticks of 240 Hz, 21 ms
+#define BUDGET_BLOCKS   8000    // Task budgets in cycles, see sched.h
+#define BUDGET_COMMANDS 6000
+#define BUDGET_REDRAW   6000
+#define BUDGET_READOUT  6000
+#define BUDGET_COUNTER  500
+#define POT_RATES(X)	/* Function 3: sampling rates in Hz of the 16 potentiometer steps */ \
+    X(16) X(17) X(18) X(19) X(20) X(25) X(30) X(50) X(70) X(88) X(108) X(126) X(145) X(173) X(192) X(228)
+#define POT_HZ(hz)      hz,
+#define POT_RELOAD(hz)  RATE_RELOAD(hz, RATE_LATENCY),
+const unsigned char sampling[16] = { POT_RATES(POT_HZ) };
+const unsigned int TMRcnt[16] = { POT_RATES(POT_RELOAD) };	// TMR0 reloads, built by the compiler
+#define LATENCY_ECG     54      // Cycles from TMR0 overflow to reload in case 1 of isr()
+#define LATENCY_SCAN    76      // and in case 11
+#define LATENCY_PPG     54      // and in case 10, same path as case 1
+#define NO_BLOCK    0xFF
+const unsigned char block_ch[13] = {	// A/D channel filtered in blocks by main(), per function
+    NO_BLOCK, NO_BLOCK, 0, 0, 0, 0, 0, 0, 0, 1, NO_BLOCK, NO_BLOCK, 1 };
+const unsigned char rhythm_name[ECG_RHYTHMS][6] = { "Sinus", "Bigem", "A-fib", "Block" };
 
 void SetupBluetooth() { /*************** set up Bluetooth modem Roving RN-42 *****************/
-    SPBRG = 1;          // Push up to 115200 BAUD to configure the BL module.
-    Delay_ms(500);
+    TxFlush();          // Anything still queued for the LCD is meaningless at the new rate
+    FrameReset();       // Start the frame stream over at seq 0
+    hal_uart_baud(1);   // Push up to 115200 BAUD to configure the BL module.
+    FrameStream(0);     // Stream from BT_SETTLE_MS on, see Readout(): isr() calls this too
+    btReady = TimeAfter(TIME_MS(BT_SETTLE_MS));
+    btWait = 1;
 //    TransmitBT("$");      // Enter command mode
 //    TransmitBT("$");
 //    TransmitBT("$");
-//    Delay_ms(100);      // Wait for the BL module to respond
+//    DelayMs(100);       // Wait for the BL module to respond
 //    PrintLine((const unsigned char*)"U,115200,N", 8);   // Tell it that we want 9600 BAUD
-//    Delay_ms(100);
+//    DelayMs(100);
 }
 
 
-void SetupSerial(){  /*********** Set up the USART Asynchronous Transmit (pin 25) ************/
-// For LCD - use SPBRG = 25;  9600 BAUD at 4MHz: 4,000,000/(16x9600) - 1 = 25.04
-// For Bluetooth - use SPBRG = 1; 115200 BAUD at 4MHz: 4,000,000/(16x115200) - 1 = 1
-    TRISC = 0x80;					// Transmit and receive, 0xC0 if transmit only
-    SPBRG = 25;
-    TXSTAbits.TXEN = 1;				// Transmit enable
-    TXSTAbits.SYNC = 0;				// Asynchronous mode
-    RCSTAbits.CREN = 1;				// Continuous receive (receiver enabled)
-    RCSTAbits.SPEN = 1;				// Serial Port Enable
-    TXSTAbits.BRGH = 1;				// High speed baud rate
-}
-
-void SetupADC(unsigned char channel){ 	/******** Configure A/D and Set the Channel **********/
-    ADCON0 = (channel << 2) + 0b00000001;   // its 5-2 = channel; bit 1: GO; bit 0: Power On
-    PIE1bits.ADIE = 0;		// Turn off the AD interrupt
-    PIR1bits.ADIF = 0;		// Reset the AD interrupt flag
-}
-
 void ClearScreen(){   /************************** Clear LCD Screen ***************************/
-    Transmit(254);					// See datasheets for Serial LCD and HD44780
-    Transmit(0x01);					// Available on our course webpage
+    LcdReset();						// Frame buffer and display, see lcd.h
 }
 
 void Backlight(unsigned char state){  /************* Turn LCD Backlight on/off ***************/
@@ -132,557 +140,604 @@ void Backlight(unsigned char state){  /************* Turn LCD Backlight on/off *
 }
 
 void SetPosition(unsigned char position){ 	/********** Set LCD Cursor Position  *************/
-    Transmit(254);
-    Transmit(128 + position);
+    LcdGoto(position);              // In the frame buffer: the display follows by difference
 }
 
 void PrintLine(const unsigned char *string, unsigned char numChars){ /**** Print characters ****/
     unsigned char count;
-    for (count=0; count<numChars; count++) Transmit(string[count]);
+    for (count=0; count<numChars; count++) LcdPut(string[count]);
 }
 
-void PrintInt(int value, unsigned char position){ /******** Print number at position *********/
-    int units, tens, hundreds, thousands;
-    SetPosition(position);				// Set at the present position
-    if (value > 9999) {
-        PrintLine((const unsigned char*)"Over", 4);
-        return;
+void FunctionSetup(){  /*********** A/D channels, sampling rate and blocks of a new function ***/
+    unsigned int reload;
+    ScanSetup(scan_set[function]);		// A/D channels of the new function
+    functionBT = function | 0xF0;       // function code for Android
+    if (function >= 4 && function <= 7) filterSel = function - 4;	// Sets 0-3 by default
+    if (function == 3) {				// Rate from the potentiometer, see FilterBlock()
+        rateHz = sampling[counter];
+        reload = TMRcnt[counter];
     }
-    if (value < -9999) {
-        PrintLine((const unsigned char*)"Under", 5);
-        return;
+    else if (function == 9 || function == 12) {	// Sampling rate = 200 Hz
+        rateHz = 200;
+        reload = RATE_RELOAD(200, RATE_LATENCY);	// Same ISR path for all: same latency
     }
-    if (value < 0) {
-        value = -value;
-        Transmit(45);
+    else {								// Sampling rate = 240 Hz
+        rateHz = 240;
+        reload = RATE_RELOAD(240, RATE_LATENCY);
     }
-    else Transmit(43);
-    thousands = value / 1000;		// Get the thousands digit, convert to ASCII and send
-    if (thousands != 0) Transmit(thousands + 48);
-    value = value - thousands * 1000;
-    hundreds = value / 100;			// Get the hundreds digit, convert to ASCII and send
-    Transmit(hundreds + 48);
-    value = value - hundreds * 100;
-    tens = value / 10;				// Get the tens digit, convert to ASCII and send
-    Transmit(tens + 48);
-    units = value - tens * 10;
-    Transmit(units + 48);			// Convert to ASCII and send
+    rate_H = reload >> 8;
+    rate_L = reload;
+    if (block_ch[function] == NO_BLOCK) rateHz = 0;
+    BlockReset(function);
+    blockFunction = NO_BLOCK;			// FilterBlock() starts the function over
+    hrCount = hrBeats = 0;				// EE_EV_HR records start over
+    hal_pin_write(C, 3, 0);				// PPG LEDs off, function 11 lights RC3 again
+    hal_pin_write(C, 1, 0);
+    if (function == 10) PpgInit();		// Red LED first
 }
 
-void interrupt isr(void) { /************ high priority interrupt service routine *************/
-    if (INTCONbits.TMR0IF == 1) {	// When there is a timer0 overflow, this loop runs
-        INTCONbits.TMR0IE = 0;		// Disable TMR0 interrupt
-        INTCONbits.TMR0IF = 0;		// Reset timer 0 interrupt flag to 0
-        switch (function) {
-        case 0:
-            TMR0H = 0xEF;       // Reload TMR0 for 4.167 ms count, Sampling rate = 240 Hz
-            TMR0L = 0xEA;       // 0xFFFF-0xEFB8 = 0x1047 = 4167, adjust for delay by 50 us
-            break;
-        case 1:					// Function 1: ECG simulation
-            TMR0H = 0xFC;		// Reload TMR0 for 1 ms count, sampling rate = 1KHz
-            TMR0L = 0x4D;		// 0xFFFF-0xFC17 = 0x3E8 = 1000,adust for delay by 54 us
-            switch (mode) {
-                case 0:										// P wave up
-                    counter++;		output++;		if (counter == 30) mode++;
-                    break;
-                case 1:										// P wave flat
-                    counter--;		if (counter == 0) mode++;
-                    break;
-                case 2:										// P wave down
-                    counter++;		output--;		if (counter == 30) mode++;
-                    break;
-                case 3:										// PR segment
-                    counter++;		if (counter == 100) mode++;
-                    break;
-                case 4:										// QRS complex - Q
-                    counter++;		output -= 3;
-                    if (counter == 105){
-                        counter = 0;
-                        mode++;
-                    }
-                    break;
-                case 5:										// QRS complex - R up
-                    counter++;		output += 6;	if (counter == 30) mode++;
-                    break;
-                case 6:										// QRS complex - R down
-                    counter++;		output -= 6;	if (counter == 62) mode++;
-                    break;
-                case 7:										//QRS complex - S
-                    counter++;		output += 3;
-                    if (counter == 71) {
-                        mode++;
-                        counter = 0;
-                    }
-                    break;
-                case 8:										// ST segment
-                    counter++;
-                    if (counter == 89){
-                        counter = 0;
-                        mode++;
-                    }
-                    break;
-                case 9:										// T wave up
-                    counter++;		output++;		if (counter == 55)mode++;
-                    break;
-                case 10:									// T wave flat
-                    counter++;		if (counter == 110) mode++;
-                    break;
-                case 11:									// T wave down
-                    counter++;		output--;		if (counter == 165) mode++;
-                    break;
-                case 12:									// End ECG
-                    counter--;		if (counter == 0) mode++;
-                    break;
-                case 13:									// Reset ECG
-                    counter++;
-                    if (counter == 202){
-                        counter = mode = 0;
-                        output = 50;
-                    }
-                    break;
-            }
-            PORTD = output;
-            if (enableBT) {
-                skipCount++;
-                if (skipCount == 8) {
-                    TransmitBT(functionBT);
-                    TransmitBT(output);
-                    TransmitBT(128);
-                    skipCount = 0;
-                }
-            }
-            break;
-        case 2:						// Function 2: Echo
-            TMR0H = 0xEF;           // Reload TMR0 for 4.167 ms count, Sampling rate = 240 Hz
-            TMR0L = 0xEF;           // 0xFFFF-0xEFB8 = 0x1047 = 4167, adjust for delay by 55 us
-            data0 = ReadADC();		// Read A/D and save the present sample in data0
-            output = data0;
-            PORTD = output;			// Echo back
-            if (enableBT) {
-                skipCount++;
-                if (skipCount == 2) {
-                    TransmitBT(functionBT);
-                    TransmitBT(data0);
-                    TransmitBT(output);
-                    skipCount = 0;
-                }
-            }
-            break;
-        case 3:						// Function 3: Echo (vary rate)
-            TMR0H = sampling_H;		// Reload TMR0 high-order byte
-            TMR0L = sampling_L;		// Reload TMR0 low-order byte
-            SetupADC(2);					// Switch to A/D channel AN2
-            counter = ReadADC();			// Read potentiometer setting from AN2
-            SetupADC(0);					// Switch to A/D channel AN0
-            counter = counter >> 4;			// Scale it to 0-15
-            sampling_L = TMRcntL[counter];	// Load TMR0 low-order byte
-            sampling_H = TMRcntH[counter];	// Load TMR0 high-order byte
-            data0 = ReadADC();		// Read A/D and save the present sample in data0
-            output = data0;
-            PORTD = data0;			// Echo back
-            if (enableBT) {
-                skipCount++;
-                if (skipCount == 2) {
-                    TransmitBT(functionBT);
-                    TransmitBT(data0);
-                    TransmitBT(output);
-                    skipCount = 0;
-                }
-            }
-            break;
-        case 4:						// Function 4: Derivative
-            TMR0H = 0xEF;           // Reload TMR0 for 4.167 ms count, Sampling rate = 240 Hz
-            TMR0L = 0xF6;           // 0xFFFF-0xEFB8 = 0x1047 = 4167, adjust for delay by 62 us
-            data1 = data0;			// Store previous data points
-            data0 = ReadADC();		// Read A/D and save the present sample in data0
-            dummy = (int)data0 - data1 + 128;	// Take derivative & shift to middle
-            if (dummy < 0) dummy = 0;       // Chop off if outside the range of 0 - 255
-            if (dummy > 255) dummy = 255;   
+void FilterBlock(unsigned char fn, const unsigned char *x){  /*** One block through function fn **/
+    unsigned char i, k, y[BLOCK_N], bt[BLOCK_N], beats = 0;
+    if (fn != blockFunction) {
+        blockFunction = fn;
+        if (fn == 9) DspMOBDInit();	// Thresholds and RR history retrain on entry
+        if (fn == 12) PTInit();
+    }
+    switch (fn) {
+    case 2:						// Function 2: Echo
+        for (i = 0; i < BLOCK_N; i++) y[i] = bt[i] = data0 = x[i];
+        break;
+    case 3:						// Function 3: Echo (vary rate)
+        for (i = 0; i < BLOCK_N; i++) y[i] = bt[i] = data0 = x[i];
+        counter = ScanLatest(2) >> 4;	// Potentiometer setting from AN2, scaled to 0-15
+        rateHz = sampling[counter];
+        hal_tmr0_irq(0);
+        rate_H = TMRcnt[counter] >> 8;	// TMR0 reload from the next tick on
+        rate_L = TMRcnt[counter];
+        hal_tmr0_irq(1);
+        break;
+    case 4:						// Function 4: Derivative
+    case 5:						// Function 5: Low-pass filter
+    case 6:						// Function 6: High-frequency enhancement filter
+    case 7:						// Function 7: 60Hz notch filter
+        if (filter_set != filterSel) FilterSelect(filterSel);	// Set 4-7 or from Bluetooth
+        for (i = 0; i < BLOCK_N; i++) {
             output2 = output1;
             output1 = output;
-            output = (unsigned char)dummy;                    
-            PORTD = output;
-            if (enableBT) {
-                d2 = d1;
+            y[i] = bt[i] = output = FilterStep(x[i]);
+            if (enableBT && (filter_set == FILTER_DERIVATIVE || filter_set == FILTER_HIFREQ)) {
+                d2 = d1;				// Bluetooth: hold the output over a step of more than 40
                 d1 = d0;
-                d0 = (int)data0 - data1;
+                if (filter_set == FILTER_DERIVATIVE) d0 = (int)output - 128;	// x(n) - x(n-1)
+                else d0 = (int)output - x[i];	// x(n) - smoother
                 if (d0 < 0) d0 = -d0;
-                skipCount++;
-                if (skipCount == 2) {
-                    if (d2 > 40) output = output2;
-                    if (d1 > 40) output = output1;
-                    TransmitBT(functionBT);
-                    TransmitBT(data0);
-                    TransmitBT(output);
-                    skipCount = 0;
-                }
+                if (d2 > 40) output = output2;
+                if (d1 > 40) output = output1;
+                bt[i] = output;
             }
-            break;
-        case 5:						// Function 5: Low-pass filter
-            TMR0H = 0xEF;           // Reload TMR0 for 4.167 ms count, Sampling rate = 240 Hz
-            TMR0L = 0xF6;           // 0xFFFF-0xEFB8 = 0x1047 = 4167, adjust for delay by 62 us
-            data2 = data1;			// Store previous data points
-            data1 = data0;
-            data0 = ReadADC();		// Read A/D and save the present sample in data0
-            dummy = ((int)data0 + data1 + data1 + data2) / 4;	// smoother
-            output = (unsigned char)dummy;
-            PORTD = output;         // Output to D/A
-            if (enableBT) {
-                skipCount++;
-                if (skipCount == 2) {
-                    TransmitBT(functionBT);
-                    TransmitBT(data0);
-                    TransmitBT(output);
-                    skipCount = 0;
+        }
+        break;
+    case 8:						// Function 8: Median filter
+        for (i = 0; i < BLOCK_N; i++) y[i] = bt[i] = DspMedian(x[i]);
+        break;
+    case 9:						// Function 9: Heart rate meter
+        for (i = 0; i < BLOCK_N; i++) {
+            y[i] = bt[i] = DspMOBD(x[i]);	// MOBD = Multiplication of Backwards Differences
+            if (refractory == 1) {		// If a peak is detected,
+                hal_pin_write(B, 3, 1);		// Turn buzzer/LED on (Pin 36)
+                if (mobd_hr) {			// Mean of the RR history, see dsp.h
+                    hr = mobd_hr;
+                    display = 1;		// Set display flag
+                    LogBeat(fn, mobd_hr);
                 }
-            }
-            break;
-        case 6:						// Function 6: High-frequency enhancement filter
-            TMR0H = 0xEF;           // Reload TMR0 for 4.167 ms count, Sampling rate = 240 Hz
-            TMR0L = 0xF6;           // 0xFFFF-0xEFB8 = 0x1047 = 4167, adjust for delay by 62 us
-            data2 = data1;			// Store previous data points
-            data1 = data0;
-            data0 = ReadADC();		// Read A/D and save the present sample in data0
-            dummy = ((int)data0 + data1 + data1 + data2) / 4;	// smoother
-            dummy = data0 + data0 - dummy;               
-            if (dummy < 0) dummy = 0;       // Chop off if outside the range of 0 - 255
-            if (dummy > 255) dummy = 255;   
-            output2 = output1;
-            output1 = output;
-            output = (unsigned char)dummy;                    
-            PORTD = output;
-            if (enableBT) {
-                d2 = d1;
-                d1 = d0;
-                d0 = ((int)data0 + data1 + data1 + data2) / 4;
-                d0 = data0 - d0;
-                if (d0 < 0) d0 = -d0;
-                skipCount++;
-                if (skipCount == 2) {
-                    if (d2 > 40) output = output2;
-                    if (d1 > 40) output = output1;
-                    TransmitBT(functionBT);
-                    TransmitBT(data0);
-                    TransmitBT(output);
-                    skipCount = 0;
+                beat[0] = mobd_hr;		beat[1] = rr_status;	beat[2] = rr_n;
+                for (k = 0; k < rr_n; k++) {	// History, newest first
+                    beat[3 + 2 * k] = rr_hist[k];
+                    beat[4 + 2 * k] = rr_hist[k] >> 8;
                 }
+                beats = 3 + 2 * rr_n;
             }
-            break;
-        case 7:						// Function 7: 60Hz notch filter
-            TMR0H = 0xEF;           // Reload TMR0 for 4.167 ms count, Sampling rate = 240 Hz
-            TMR0L = 0xFC;           // 0xFFFF-0xEFB8 = 0x1047 = 4167, adjust for delay by 68 us
-            data2 = data1;			// Store previous data points
-            data1 = data0;
-            data0 = ReadADC();		// Read A/D and save the present sample in data0
-            dummy = ((int)data0 + data2) / 2;	// 60 Hz notch
-            output = (unsigned char)dummy;
-            PORTD = output;         // Output to D/A
-            if (enableBT) {
-                skipCount++;
-                if (skipCount == 2) {
-                    TransmitBT(functionBT);
-                    TransmitBT(data0);
-                    TransmitBT(output);
-                    skipCount = 0;
+            else if (!refractory) hal_pin_write(B, 3, 0);	// Off again after 200 ms
+        }
+        break;
+    case 12:					// Function 12: Pan-Tompkins QRS detector
+        for (i = 0; i < BLOCK_N; i++) {
+            y[i] = bt[i] = PTStep(x[i]);	// Integrated signal, 8 bits
+            if (pt_beat) {				// QRS found, PT_DELAY samples after its R wave
+                pt_beat = 0;
+                refractory = 1;
+                hal_pin_write(B, 3, 1);		// Turn buzzer/LED on (Pin 36)
+                display = 1;
+                if (pt_rr_avg) {
+                    hr = 12000 / pt_rr_avg;
+                    LogBeat(fn, hr > 255 ? 255 : hr);
                 }
+                beat[0] = pt_rpeak;		beat[1] = pt_rpeak >> 8;
+                beat[2] = pt_rpeak >> 16;	beat[3] = pt_rpeak >> 24;
+                beat[4] = pt_rr;			beat[5] = pt_rr >> 8;
+                beats = 6;
             }
-            break;
-        case 8:						// Function 8: Median filter
-            TMR0H = 0xEF;           // Reload TMR0 for 4.167 ms count, Sampling rate = 240 Hz
-            TMR0L = 0xFF;           // 0xFFFF-0xEFB8 = 0x1047 = 4167, adjust for delay by 71 us
-            data0 = ReadADC();		// Read A/D and save the present sample in data0
-            for (i=8; i>0; i--) array[i] = array[i-1];	// Store the previous 8 points
-            array[0] = data0;			// Get new data point from A/D
-            for (i=0; i<9; i++) rank[i] = array[i];	// Make a copy of data array
-            for (i=0; i<5; i++) {		// Perform a bubble sort
-                for (j=i+1; j<9; j++) {
-                    if (rank[i] < rank[j]) {
-                        temp = rank[i];		// Swap
-                        rank[i] = rank[j];
-                        rank[j] = temp;
-                    }
-                }
+            else if (refractory && ++refractory == 40) {	// Buzzer on for 200 ms
+                refractory = 0;
+                hal_pin_write(B, 3, 0);
             }
-            output = rank[4];
-            PORTD = output;			// Median is at rank[4] of rank[0-8]
-            if (enableBT) {
-                skipCount++;
-                if (skipCount == 2) {
-                    TransmitBT(functionBT);
-                    TransmitBT(data0);
-                    TransmitBT(output);
-                    skipCount = 0;
-                }
+        }
+        break;
+    }
+    for (i = 0; i < BLOCK_N; i++) BlockOut(y[i]);
+    if (enableBT) {
+        hal_tmr0_irq(0);			// isr() frames functions 1, 10 and 11
+        for (i = 0; i < BLOCK_N; i++) FrameSample(functionBT, x[i], bt[i]);
+        if (beats) FrameRecord(functionBT, beat, beats);
+        hal_tmr0_irq(1);
+    }
+}
+
+void SaveSettings(){  /************** Median window, ECG options and threshold to the EEPROM ***/
+    eeRec[0] = median_size;	eeRec[1] = ecg_morph;	eeRec[2] = ecg_rhythm;	eeRec[3] = ecg_opts;
+    eeRec[4] = mobd_fixed;	eeRec[5] = mobd_fixed >> 8;
+    EeLog(EE_KEY_BME, eeRec, 6);	// Written by EeService() in the background
+}
+
+void LogBeat(unsigned char fn, unsigned char bpm){  /****** One EE_EV_HR record per 64 beats ***/
+    if (!hrCount || bpm < hrMin) hrMin = bpm;
+    if (!hrCount || bpm > hrMax) hrMax = bpm;
+    if (!hrCount) hrSum = 0;
+    hrSum += bpm;
+    hrBeats++;
+    if (++hrCount < HR_LOG_BEATS) return;
+    hrCount = 0;
+    eeRec[0] = fn;			eeRec[1] = hrBeats;		eeRec[2] = hrBeats >> 8;
+    eeRec[3] = hrSum / HR_LOG_BEATS;	eeRec[4] = hrMin;	eeRec[5] = hrMax;
+    EeLog(EE_EV_HR, eeRec, 6);
+}
+
+void LogFaults(){  /************************ EE_EV_FAULT when a drop or error counter moved ***/
+    unsigned char i, now[6], changed = 0;
+    now[0] = frame_drops;	now[1] = tx_drops;	now[2] = rx_drops;
+    now[3] = cmd_errors;	now[4] = block_overruns;	now[5] = block_underruns;
+    for (i = 0; i < 6; i++) {
+        if (now[i] != faults[i]) changed = 1;
+        faults[i] = now[i];
+    }
+    if (changed) EeLog(EE_EV_FAULT, faults, 6);
+}
+
+void RunCommand(unsigned char code){  /*********** One-byte or framed command, see command.h ***/
+    unsigned char reply[EE_SLOT], ok = CMD_OK, i;	// Longest reply: CMD_LOG
+    unsigned int hz, reload;
+    short level;
+    if (code <= 9) {                        // One-byte commands of the Android app
+        if (code == 1) {                    // 1 for increment
+            if (function >= 12) function = 0;	// Set function range 0-12
+            else function++;
+        }
+        if (code == 2) {                    // 2 for decrement
+            if (function == 0) function = 12;	// Set function range 0-12
+            else function--;
+        }
+        if (code == 3) ProfDump();          // 3 for the ISR and task cycle budget tables, idle %
+        if (code == 4) {                    // 4 to restart them
+            ProfClear();
+            SchedClear();
+        }
+        if (code == 5) {                    // 5 for the next median window size
+            hal_tmr0_irq(0);
+            if (median_size < 9) MedianInit(9, output);     // 5 -> 9 -> 15 -> 31 -> 5
+            else if (median_size < 15) MedianInit(15, output);
+            else if (median_size < 31) MedianInit(31, output);
+            else MedianInit(5, output);
+            hal_tmr0_irq(1);
+        }
+        if (code == 6) ecg_morph = (ecg_morph + 1) % ECG_MORPHS;     // 6 for the next ECG shape
+        if (code == 7) ecg_rhythm = (ecg_rhythm + 1) % ECG_RHYTHMS;  // 7 for the next rhythm
+        if (code == 8) ecg_opts = (ecg_opts + 1) & (ECG_NOISE | ECG_WANDER);  // 8: noise, wander
+        if (code == 9) filterSel = (filterSel + 1) % (FILTER_USER + 1);	// 9 for the next filter
+        if (code >= 5 && code <= 8) SaveSettings();	// Kept over a power cycle
+        hal_irq_disable();
+        FunctionSetup();                    // A/D channels, rate and blocks
+        hal_irq_enable();
+        SchedPost(taskRedraw);              // Redraw() updates the LCD display
+        return;
+    }
+    switch (code) {
+    case CMD_FUNCTION:
+        if (cmd_len != 1 || cmd_data[0] > 12) ok = CMD_BAD;
+        else {
+            hal_irq_disable();
+            function = cmd_data[0];
+            FunctionSetup();
+            hal_irq_enable();
+        }
+        break;
+    case CMD_RATE:
+        hz = cmd_len == 2 ? cmd_data[0] | (unsigned int)cmd_data[1] << 8 : 0;
+        reload = hz <= 1000 ? RateReload(hz, RATE_LATENCY) : 0;	// 0 if out of range
+        if (!reload || block_ch[function] == NO_BLOCK || function == 3)
+            ok = CMD_BAD;				// Function 3 takes its rate from the potentiometer
+        else if (function == 9 || function == 12)
+            ok = CMD_BAD;				// Their beat detectors are tuned for 200 Hz, see dsp.h
+        else {
+            rateHz = hz;
+            hal_tmr0_irq(0);
+            rate_H = reload >> 8;
+            rate_L = reload;
+            hal_tmr0_irq(1);
+        }
+        break;
+    case CMD_THRESHOLD:
+        level = cmd_len == 2 ? (short)(cmd_data[0] | cmd_data[1] << 8) : -1;
+        if (level != 0 && level < MOBD_FLOOR) ok = CMD_BAD;	// Lower: every sample is a beat
+        else {
+            DspMOBDThreshold(level);	// In main(), no race
+            SaveSettings();
+        }
+        break;
+    case CMD_FILTER:
+        if (cmd_len != 1 || cmd_data[0] > FILTER_USER) ok = CMD_BAD;
+        else filterSel = cmd_data[0];	// FilterBlock() switches at the next block
+        break;
+    case CMD_FIR:
+    case CMD_BIQUAD:
+        if (!FilterLoad(code == CMD_FIR ? FILTER_FIR : FILTER_BIQUAD, cmd_data, cmd_len)) ok = CMD_BAD;
+        else filterSel = FILTER_USER;
+        break;
+    case CMD_STREAM:
+        if (cmd_len != 1 || cmd_data[0] > 1) ok = CMD_BAD;
+        else {
+            hal_tmr0_irq(0);			// isr() frames functions 1, 10 and 11
+            FrameStream(cmd_data[0]);
+            hal_tmr0_irq(1);
+        }
+        break;
+    case CMD_STATS:
+        i = 0;
+        reply[i++] = function;			reply[i++] = filterSel;
+        reply[i++] = threshold;			reply[i++] = threshold >> 8;
+        reply[i++] = rateHz;			reply[i++] = rateHz >> 8;
+        reply[i++] = frame_drops;		reply[i++] = tx_drops;
+        reply[i++] = rx_drops;			reply[i++] = cmd_errors;
+        reply[i++] = block_overruns;	reply[i++] = block_underruns;
+        reply[i++] = frame_stream;
+        hal_tmr0_irq(0);
+        FrameReply(code | CMD_REPLY, reply, CMD_STATS_LEN);
+        hal_tmr0_irq(1);
+        return;
+    case CMD_LOG:
+        if (cmd_len != 1 || !EeRecord(cmd_data[0], reply)) ok = CMD_BAD;
+        else {
+            hal_tmr0_irq(0);
+            FrameReply(code | CMD_REPLY, reply, EE_SLOT);
+            hal_tmr0_irq(1);
+            return;
+        }
+        break;
+    default:
+        ok = CMD_BAD;
+        break;
+    }
+    SchedPost(taskRedraw);                  // LCD and LEDs show the change
+    hal_tmr0_irq(0);
+    FrameReply(code | CMD_REPLY, &ok, 1);
+    hal_tmr0_irq(1);
+}
+
+void Blocks(){  /*************** Posted by isr() when BlockPut() filled a block: filter it ***/
+    unsigned char *block;
+    if ((block = BlockFull()) != 0) {			// BLOCK_N samples from isr()
+        if (block_tag == function) FilterBlock(block_tag, block);
+        BlockDone();
+    }
+}
+
+void Commands(){  /******************* Posted by isr() on received bytes: run the commands ***/
+    while ((temp = CmdPoll()) != 0)    // Received by RCIF into the ring, see usart.c
+        if (enableBT) RunCommand(temp);
+}
+
+void Redraw(){  /********************* Function name and LEDs, posted on a function change ***/
+    LogFaults();
+    hal_tmr0_irq(0);		// Disable TMR0 interrupt
+    if (!enableBT) {
+        LcdNum(8, function, 3, FMT_DIGITS(2));	// Update the function number on LCD display
+        SetPosition(64);        // Go to beginning of Line 2;
+        switch (function) {
+            case 0:  PrintLine((const unsigned char*)"Binary counter  ",16); break;
+            case 1:  PrintLine((const unsigned char*)"ECG    bpm      ",16);
+                     SetPosition(75);
+                     PrintLine(rhythm_name[ecg_rhythm], 5);
+                     ecgShown = 0; break;           // Rate printed below
+            case 2:  PrintLine((const unsigned char*)"Echo (A/D - D/A)",16); break;
+            case 3:  PrintLine((const unsigned char*)"Echo @ fs     Hz",16); break;
+            case 4:
+            case 5:
+            case 6:
+            case 7:  PrintLine((const unsigned char*)FilterGet(filterSel)->name,16); break;
+            case 8:  PrintLine((const unsigned char*)"Median filter   ",16);
+                     LcdNum(77, median_size, 3, FMT_DIGITS(2)); break;  // Window size
+            case 9:  PrintLine((const unsigned char*)"HR =       bpm  ",16); break;
+            case 10: PrintLine((const unsigned char*)"PPG    bpm R=   ",16); break;
+            case 11: PrintLine((const unsigned char*)"ECG + PPG scan  ",16); break;
+            case 12: PrintLine((const unsigned char*)"    bpm RR      ",16); break;
+        }
+        enableBT = hal_pin_read(B, 2);   // Check again for BLUETOOTH enabled
+    }
+    if (function) {
+        LEDcount = function << 4;   // display "function" at the LEDs
+        hal_port_write(B, LEDcount);
+    }
+    hal_tmr0_irq(1);          // Ensable TMR0 interrupt
+}
+
+void Readout(){  /******************************** Every tick: the numbers of the function ***/
+    unsigned char up;
+    if (btWait) {                       // Bluetooth module settled: start the stream
+        hal_int_irq(2, 0);              // SetupBluetooth() from INT2 writes btReady
+        up = TimeUp(btReady);
+        hal_int_irq(2, 1);
+        if (up) {
+            btWait = 0;
+            FrameStream(1);
+        }
+    }
+    switch (function) {
+    case 1:				// Function 1: ECG simulation, rate from the potentiometer
+        if (ecgShown != ecg_bpm && !enableBT) {
+            ecgShown = ecg_bpm;
+            LcdNum(68, ecgShown, 3, FMT_DIGITS(2));
+        }
+        break;
+    case 3:				// Function 3: Echo (vary rate)
+        hal_tmr0_irq(0);			// Disable TMR0 interrupt
+        if (counter1 != counter && !enableBT) {
+            temp = sampling[counter];
+            LcdNum(74, temp, 3, FMT_DIGITS(2));
+            counter1 = counter;
+        }
+        hal_tmr0_irq(1);			// Enable TMR0 interrupt
+        break;
+    case 9:				// Function 9: Multiplication of Backward Differences (MOBD)
+        if (display && !enableBT){		// Display Heart Rate in 3 digits
+            LcdNum(71, hr, 3, FMT_DIGITS(2) | FMT_CLAMP);	// Up to 999 bpm
+            display = 0;				// Reset display flag
+        }
+        break;
+    case 10:			// Function 10: pulse rate and SpO2 ratio R at each pulse peak
+        if (ppg_pulse) {
+            hal_tmr0_irq(0);			// Latched by isr() at the peak
+            ppg_pulse = 0;
+            pulse[0] = ppg_interval;		pulse[1] = ppg_interval >> 8;
+            pulse[2] = ppg_amp[PPG_RED];	pulse[3] = ppg_amp[PPG_RED] >> 8;
+            pulse[4] = ppg_level[PPG_RED];	pulse[5] = ppg_level[PPG_RED] >> 8;
+            pulse[6] = ppg_amp[PPG_IR];		pulse[7] = ppg_amp[PPG_IR] >> 8;
+            pulse[8] = ppg_level[PPG_IR];	pulse[9] = ppg_level[PPG_IR] >> 8;
+            ratio = 0;					// R x 100 = (ACr / DCr) / (ACir / DCir) x 100
+            if (ppg_amp[PPG_IR] > 0 && ppg_level[PPG_RED])
+                ratio = 100L * ppg_amp[PPG_RED] * ppg_level[PPG_IR]
+                        / ((long)ppg_amp[PPG_IR] * ppg_level[PPG_RED]);
+            if (ratio > 255) ratio = 255;
+            pulse[10] = ratio;
+            if (enableBT) FrameRecord(functionBT, pulse, 11);
+            hal_tmr0_irq(1);
+            if (!enableBT && ppg_interval) {
+                hr = 60 * PPG_HZ / ppg_interval;
+                LcdNum(68, hr, 3, FMT_DIGITS(2) | FMT_CLAMP);
+                LcdNum(77, ratio, 3, FMT_DIGITS(2));
             }
-            break;
-        case 9:						// Function 9: Heart rate meter
-            TMR0H = 0xEC;			// Reload TMR0 for 5 ms count, sampling rate = 200 Hz
-            TMR0L = 0xC3;			// 0xFFFF-0xEC77 = 0x1388 = 5000, adjust for delay by 76 us
-            data1 = data0;			// Move old ECG sample to data1
-            data0 =  ReadADC();		// Store new ECG sample from ADC to data0
-            if (enableBT) {
-                skipCount++;
-                if (skipCount == 2) {
-                    TransmitBT(functionBT);
-                    TransmitBT(data0);
-                    TransmitBT(output);
-                    skipCount = 0;
-                }
-            }                         // MOBD = Multiplication of Backwards Differences
-            d2 = d1;					// Move oldest difference to d2
-            d1 = d0;					// Move older difference to d1
-            d0 = (int)data0 - data1;	// Store new difference in d0, (int) casting important
-            rri_count++;				// Increment RR-interval
-            mobd = 0;					// mobd = 0, unless sign consistency is met:
-            if (d0 > 0 && d1 > 0 && d2 > 0){	// (1) If 3 consecutive positive differences
-                mobd = d0 * d1;			// Multiply first two differences
-                mobd = mobd * d2;		// Multiply the oldest difference
+        }
+        break;
+    case 12:			// Function 12: Pan-Tompkins, averaged heart rate and last RR in ms
+        if (display && !enableBT) {
+            display = 0;
+            if (pt_rr_avg) {
+                hr = 12000 / pt_rr_avg;
+                if (hr > 255) hr = 255;
+                LcdNum(64, hr, 3, FMT_DIGITS(2));
+                LcdNum(75, pt_rr * 5, 5, FMT_LEFT | FMT_PLUS | FMT_DIGITS(3));  // Pads a longer RR
             }
-            if (d0 < 0 && d1 < 0 && d2 < 0){	// (2) If 3 consecutive negative differences
-                d0 = -d0;				// Take absolute value of differences
-                d1 = -d1;
-                d2 = -d2;
-                mobd = d0 * d1;			// Multiply first two differences
-                mobd = mobd * d2;		// Multiply the oldest difference
+        }
+        break;
+    }
+}
+
+void Counter(){  /************************** Every COUNT_TICKS: function 0, binary counter ***/
+    if (function) return;
+    LEDcount++;						// Upcounter
+    hal_port_write(B, LEDcount & 0b11110000);	// Mask out the lower 4 bits
+    hal_dac_write(LEDcount);		// Output ramp to verify linearity of the D/A
+    if (enableBT) {
+        hal_tmr0_irq(0);            // The ISR fills frames for the other functions
+        FrameSample(functionBT, LEDcount, 128);
+        hal_tmr0_irq(1);
+    }
+}
+
+void interrupt isr(void) { /************ high priority interrupt service routine *************/
+    if (hal_tmr0_pending()) {	// When there is a timer0 overflow, this loop runs
+        ProfEnter();                // Start of the ISR budget for this function
+        hal_tmr0_irq(0);		// Disable TMR0 interrupt
+        hal_tmr0_ack();		// Reset timer 0 interrupt flag to 0
+        if (block_ch[function] != NO_BLOCK) {	// Functions 2-9, 12: filtered in main()
+            hal_tmr0_reload(rate_H, rate_L);	// Same path for all: same reload adjustment
+            ScanTick();
+            if (BlockPut(ScanLatest(block_ch[function]))) SchedPost(taskBlocks);
+            hal_dac_write(BlockDac());	// Output of FilterBlock(), 2-3 blocks later
+        }
+        else switch (function) {
+        case 0:
+            hal_tmr0_reload(RATE_HIGH(240, RATE_LATENCY), RATE_LOW(240, RATE_LATENCY));	// 240 Hz
+            break;
+        case 1:					// Function 1: ECG simulation
+            hal_tmr0_reload(RATE_HIGH(1000, LATENCY_ECG), RATE_LOW(1000, LATENCY_ECG));	// 1 KHz
+            if (lastFunction != 1) {	// Rate from the potentiometer on AN2: on entry
+                ScanTick();
+                EcgRate(ScanLatest(2));
             }
-            if (refractory){			// Avoid detecting extraneous peaks after QRS	
-                refractory++;
-                if (refractory == 40){	// Delay for 200 ms
-                    refractory = 0;		// Reset refractory flag to 0
-                    PORTBbits.RB3 = 0;	// Turn buzzer/LED off (Pin 36)
+            output = EcgStep();		// Beat templates, see ecgsynth.h
+            hal_dac_write(output);
+            if (enableBT) FrameSample(functionBT, output, 128);  // All 1000 samples/s, framed
+            if (ecg_beat) {				// R wave of a simulated beat
+                ScanTick();				// and once per beat
+                EcgRate(ScanLatest(2));
+                if (enableBT) {			// Type and RR in ms: the truth for QRS detectors
+                    beat[0] = ecg_beat;	beat[1] = ecg_rr;	beat[2] = ecg_rr >> 8;
+                    FrameRecord(functionBT, beat, 3);
                 }
+                ecg_beat = 0;
             }
-            else if (mobd > threshold){	// If a peak is detected,
-                refractory = 1;			// Set refractory flag
-                PORTBbits.RB3 = 1;		// Turn buzzer/LED on (Pin 36)
-                display = 1;			// Set display flag										
-            }
-            if (mobd > 255) output = 255;
-            else output = (unsigned char)mobd;
-            PORTD = output;                // Output mobd value to Port D
             break;
-        case 10:				// Function 10: Photoplethysmogram
-//          TMR0H = 0xFE;       // Reload TMR0 for 5 ms count, sampling rate = 200 Hz
-//          TMR0L = 0xA5;       // 0xFF5D for 1 KHz, adjust to 1.17 KHz
-            TMR0H = 0xFE;		// Reload TMR0 high-order byte
-            TMR0L = sampling_L;		// Reload TMR0 low-order byte
-            PORTCbits.RC3 = !PORTCbits.RC3;		// Toggle RC3 (pin 18) @ 1 KHz for PPG                
-            skipCount++;
-            if (skipCount == 5) {
-                SetupADC(2);				// Switch to A/D channel AN2
-                sampling_L = ReadADC();		// Read potentiometer setting from AN2
-                SetupADC(3);				// Switch to A/D channel AN2
-            }
-            output = ReadADC();         // Read PPG from AN3
-            d0 += output;               // Average over 8 points
-            if (skipCount == 8) {       // Display 1 of 8, 1 KHz / 8 = 125 Hz
-                skipCount = 0;
-                d0 = d0 >> 3;
-                output = (unsigned char) d0;
-                d0 = 0;
-                if (enableBT) {
-                    TransmitBT(functionBT);
-                    TransmitBT(output);
-                    TransmitBT(128);
-                }
+        case 10:				// Function 10: Photoplethysmogram, red / IR demodulated
+            hal_tmr0_reload(RATE_HIGH(PPG_TICK_HZ, LATENCY_PPG), RATE_LOW(PPG_TICK_HZ, LATENCY_PPG));
+            ScanTick();					// PPG from AN3, lit as set on the last tick
+            if (PpgTick(ScanLatest(3))) {	// Both channels every 8 ticks, 125 Hz
+                hal_dac_write(ppg_out);		// IR pulse wave
+                if (enableBT) FrameSample(functionBT, ppg_red, ppg_ir);
             }
+            hal_pin_write(C, 3, ppg_led & PPG_LED_RED);			// Red LED on RC3 (pin 18)
+            hal_pin_write(C, 1, (ppg_led & PPG_LED_IR) != 0);	// IR LED on RC1 (pin 16)
+            break;
+        case 11:				// Function 11: ECG + PPG, both from one scan
+            hal_tmr0_reload(RATE_HIGH(250, LATENCY_SCAN), RATE_LOW(250, LATENCY_SCAN));	// 250 Hz
+            hal_pin_write(C, 3, 1);		// PPG LED on steadily
+            ScanTick();					// AN1 and AN3 within 52 us of each other
+            data0 = ScanLatest(1);		// ECG
+            output = ScanLatest(3);		// PPG
+            hal_dac_write(data0);
+            if (enableBT) FrameSample(functionBT, data0, output);
             break;
         }
+        SchedTick();                // The tick of main(): the sampling rate, see sched.h
         if (debounce0) debounce0--;	// switch debounce delay counter for INT0
         if (debounce1) debounce1--;	// switch debounce delay counter for INT1
         if (debounce2) debounce2--;	// switch debounce delay counter for INT2
-        PORTCbits.RC2 = !PORTCbits.RC2;		// Toggle RC2 (pin 17) for sampling frequency check
-        INTCONbits.TMR0IE = 1;		// Enable TMR0 interrupt
+        hal_pin_toggle(C, 2);		// Toggle RC2 (pin 17) for sampling frequency check
+        lastFunction = function;
+        ProfExit(function);         // Record entry-to-exit cycles for this function
+        hal_tmr0_irq(1);		// Enable TMR0 interrupt
     }
-    if (INTCONbits.INT0IF == 1) {	// INT0 (pin 33) negative edge - Function down
-        INTCONbits.INT0IE = 0;		// Disable interrupt
-        INTCONbits.INT0IF = 0;		// Reset interrupt flag
+    if (hal_int_pending(0)) {	// INT0 (pin 33) negative edge - Function down
+        hal_int_irq(0, 0);		// Disable interrupt
+        hal_int_ack(0);		// Reset interrupt flag
         if (debounce0 == 0) {
-            if (function <= 0) function = 10;	// Set function range 0-10
+            if (function <= 0) function = 12;	// Set function range 0-12
             else function--;
-            if (function == 9) SetupADC(1);		// ECG comes from AN1 channel
-            else SetupADC(0);					// Others come from AN0 channel
-            functionBT = function | 0xF0;       // function code for Android
-            update = 1;				// Signal main() to update LCD display
+            FunctionSetup();		// A/D channels, rate and blocks of the new function
+            SchedPost(taskRedraw);	// Redraw() updates the LCD display
             debounce0 = 10;			// Set switch debounce delay counter decremented by TMR0
         }
-        INTCONbits.INT0IE = 1;		// Enable interrupt
+        hal_int_irq(0, 1);		// Enable interrupt
     }
-    if (INTCON3bits.INT1IF == 1) {	// INT1 (pin 34) negative edge - Function up
-        INTCON3bits.INT1IE = 0;		// Disable interrupt
-        INTCON3bits.INT1IF = 0;		// Reset interrupt flag
+    if (hal_int_pending(1)) {	// INT1 (pin 34) negative edge - Function up
+        hal_int_irq(1, 0);		// Disable interrupt
+        hal_int_ack(1);		// Reset interrupt flag
         if (debounce1 == 0) {
-            if (function >= 10) function = 0;	// Set function range 0-10
+            if (function >= 12) function = 0;	// Set function range 0-12
             else function++;
-            if (function == 9) SetupADC(1);		// ECG comes from AN1 channel
-            else SetupADC(0);					// Others come from AN0 channel
-            functionBT = function | 0xF0;       // function code for Android
-            update = 1;				// Signal main() to update LCD display
+            FunctionSetup();		// A/D channels, rate and blocks of the new function
+            SchedPost(taskRedraw);	// Redraw() updates the LCD display
             debounce1 = 10;			// Set switch debounce delay counter decremented by TMR0
         }
-        INTCON3bits.INT1IE = 1;		// Enable interrupt
+        hal_int_irq(1, 1);		// Enable interrupt
     }
-    if (INTCON3bits.INT2IF == 1) {	// INT1 (pin 35) either edge - enableBT
-        INTCON3bits.INT2IE = 0;		// Disable interrupt
-        INTCON3bits.INT2IF = 0;		// Reset interrupt flag
+    if (hal_int_pending(2)) {	// INT1 (pin 35) either edge - enableBT
+        hal_int_irq(2, 0);		// Disable interrupt
+        hal_int_ack(2);		// Reset interrupt flag
         if (debounce2 == 0) {
             if (enableBT) {
                 enableBT = 0;       // Switching back to LCD display
                 SetupSerial();
-                INTCON2bits.INTEDG2 = 1;	// Set pin 35 (RB2/INT2) for positive edge 
-                Delay_ms(3000);		// Wait until the LCD display is ready
+                hal_int_edge(2, 1);	// Set pin 35 (RB2/INT2) for positive edge 
+                TxPause(3000);		// Hold the queue until the LCD display is ready
                 Backlight(1);       // turn LCD display backlight on
                 ClearScreen();      // Clear screen and set cursor to first position
                 PrintLine((const unsigned char*)"Function", 8);
-                update = 1;
+                SchedPost(taskRedraw);
              }
             else {                  // Switching back to Bluetooth
                 enableBT = 1;
                 SetupBluetooth();
-                INTCON2bits.INTEDG2 = 0;	// Set pin 35 (RB2/INT2) for negative edge 
-                update = 1;
+                hal_int_edge(2, 0);	// Set pin 35 (RB2/INT2) for negative edge 
+                SchedPost(taskRedraw);
             }
             debounce2 = 10;			// Set switch debounce delay counter decremented by TMR0
         }
-        INTCON3bits.INT2IE = 1;		// Enable interrupt
+        hal_int_irq(2, 1);		// Enable interrupt
     }
+    if (RxService()) SchedPost(taskCommands);   // RCIF: received bytes into the ring
+    TxService();                    // TXIF / TMR2: drain the USART transmit queues
+    TimeService();                  // TMR3: the time base, see timebase.h
 }
 
 void main(){   /****************************** Main program **********************************/
-    function = mode = LEDcount = skipCount = counter = debounce0 = debounce1 = 0; // Initialize
+    SchedInit();                // Tasks in priority order, see sched.h
+    taskBlocks = SchedAdd(Blocks, 0, BUDGET_BLOCKS);
+    taskCommands = SchedAdd(Commands, 0, BUDGET_COMMANDS);
+    taskRedraw = SchedAdd(Redraw, 0, BUDGET_REDRAW);
+    SchedAdd(Readout, 1, BUDGET_READOUT);
+    SchedAdd(Counter, COUNT_TICKS, BUDGET_COUNTER);
+    function = LEDcount = counter = debounce0 = debounce1 = 0; // Initialize
     functionBT = function | 0xF0;
-    display = do_MOBD = rri_count = 0;
-    threshold = 128;			// Threshold for the MOBD QRS-detection algorithm
-    update = 1;					// Flag to signal LCD update
-    output = 50;				// Baseline for ECG simulation
-    sampling[0] = 16;	sampling[1] = 17;	sampling[2] = 18;	sampling[3] = 19;
-    sampling[4] = 20;	sampling[5] = 25;	sampling[6] = 30;	sampling[7] = 50;
-    sampling[8] = 70;	sampling[9] = 88;	sampling[10] = 108;	sampling[11] = 126;
-    sampling[12] = 145;	sampling[13] = 173;	sampling[14] = 192;	sampling[15] = 228;
-    TMRcntH[0] = 11;	TMRcntH[1] = 26;	TMRcntH[2] = 39;	TMRcntH[3] = 50;
-    TMRcntH[4] = 60;	TMRcntH[5] = 99;	TMRcntH[6] = 125;	TMRcntH[7] = 177;
-    TMRcntH[8] = 200;	TMRcntH[9] = 211;	TMRcntH[10] = 219;	TMRcntH[11] = 225;
-    TMRcntH[12] = 229;	TMRcntH[13] = 233;	TMRcntH[14] = 235;	TMRcntH[15] = 238;
-    TMRcntL[0] = 229;	TMRcntL[1] = 66;	TMRcntL[2] = 6;     TMRcntL[3] = 114;
-    TMRcntL[4] = 185;	TMRcntL[5] = 201;	TMRcntL[6] = 212;	TMRcntL[7] = 233;
-    TMRcntL[8] = 60;	TMRcntL[9] = 166;	TMRcntL[10] = 222;	TMRcntL[11] = 9;
-    TMRcntL[12] = 25;	TMRcntL[13] = 117;	TMRcntL[14] = 177;	TMRcntL[15] = 232;
-    sampling_H = 0xF0;		// initialize for 4.167 ms count, Sampling rate = 240 Hz
-    sampling_L = 0x7C;		// 0xFFFF-0xEFB8 = 0x1047 = 4167, adjust for delay by 68 us
-    TRISA = 0b11111111;     // Set all of Port A as input
-    ADCON2 = 0b00001001;    // bit 5-3: acq time = 2 TAD;  bit 2-0: clock Fosc/8
-    ADCON1	= 0b00001010;   // bit 5: Vref - VSS; bit 4: Vref + VDD; bit 3-0: Set A0-A4
-    TRISB = 0b00000111;			// RB0-2 as inputs, others outputs, RB3 drives buzzer
-    TRISC = 0b11110011;			// RC2 as output, 1 KHz to drive LED of PPG
-    TRISD = 0b00000000;			// Set all port D pins as outputs
-    PORTD = 0;					// Set port D to 0's
-    PORTCbits.RC3 = 0;          // Turn off PPG LED
-    SetupADC(0);				// Call SetupADC() to set up channel 0, AN0 (pin 2)
-    enableBT = PORTBbits.RB2;   // Check for BLUETOOTH enabled
+    display = do_MOBD = 0;
+    MedianInit(9, 0);           // Median filter over the last 9 points
+    DspMOBDInit();				// Adaptive threshold for the MOBD QRS-detection algorithm
+    SchedPost(taskRedraw);		// LCD update
+    EcgInit();					// ECG simulation at 70 bpm until the pot is read
+    EeInit();					// Settings and log in the EEPROM, see eelog.h
+    if (EeSetting(EE_KEY_BME, eeRec)) {
+        if (eeRec[0] >= 5) MedianInit(eeRec[0], 0);
+        ecg_morph = eeRec[1] % ECG_MORPHS;
+        ecg_rhythm = eeRec[2] % ECG_RHYTHMS;
+        ecg_opts = eeRec[3] & (ECG_NOISE | ECG_WANDER);
+        DspMOBDThreshold((short)(eeRec[4] | eeRec[5] << 8));
+    }
+    eeRec[0] = ee_bad;			eeRec[1] = ee_records;
+    EeLog(EE_EV_BOOT, eeRec, 2);
+    hal_adc_init();         // Port A inputs; acq time = 2 TAD, clock Fosc/8; AN0-AN4 analog
+    hal_port_dir(B, 0b00000111);			// RB0-2 as inputs, others outputs, RB3 drives buzzer
+    hal_port_dir(C, 0b11110001);			// RC1, RC3: IR and red PPG LEDs, RC2: rate check
+    hal_port_dir(D, 0b00000000);			// Set all port D pins as outputs
+    hal_dac_write(0);			// Set port D to 0's
+    hal_pin_write(C, 3, 0);          // Turn off PPG LEDs
+    hal_pin_write(C, 1, 0);
+    FunctionSetup();
+    enableBT = hal_pin_read(B, 2);   // Check for BLUETOOTH enabled
     SetupSerial();				// Set up USART Asynchronous Transmit for LCD display
-    Delay_ms(100);	
+    TimeStart();                // TMR3 microseconds for DelayMs(), see timebase.h
+    hal_irq_enable();           // Let TxService() drain the LCD queue during the splash screen
+    DelayMs(100);
     Transmit(18);               // Ctl R to reset BAUD rate to 9600
-    Delay_ms(2500);				// Wait until the LCD display is ready
+    DelayMs(2500);				// Wait until the LCD display is ready
     if (enableBT == 0) {
         Backlight(1);           // turn LCD display backlight on
         ClearScreen();			// Clear screen and set cursor to first position
         PrintLine((const unsigned char*)"  BME 361 Demo", 14);
         SetPosition(64);		// Go to beginning of Line 2;
         PrintLine((const unsigned char*)" Biomeasurement ",16);	// Put your trademark here
-        Delay_ms(3000);
+        DelayMs(3000);
         ClearScreen();			// Clear screen and set cursor to first position
         PrintLine((const unsigned char*)"Function", 8);
     }
-    T0CON = 0b10001000;			// Turn on TMR0 and use the prescaler 000 (1:2))
-    INTCON = 0b10110000;		// GIE(7) = TMR0IE = INT0IE = 1
-    INTCONbits.TMR0IF = PIR1bits.TMR1IF = 0;
-    INTCONbits.TMR0IE = 1;		// Enable TMR0 interrupt
-    INTCON2bits.INTEDG0 = 0;	// Set pin 33 (RB0/INT0) for negative edge trigger
-    INTCON2bits.INTEDG1 = 0;	// Set pin 34 (RB1/INT1) for negative edge trigger
-    if (enableBT) INTCON2bits.INTEDG2 = 0;	// Set pin 35 (RB2/INT2) for negative edge 
-    else INTCON2bits.INTEDG2 = 1;	// Set pin 35 (RB2/INT2) for positive edge 
-    INTCONbits.INT0IF = INTCON3bits.INT1IF = INTCON3bits.INT2IF = 0;// Reset interrupt flags
-    INTCONbits.INT0IE = 1;		// Enable INT0 interrupt (function down)
-    INTCON3bits.INT1IE = 1;		// Enable INT1 interrupt (function up)
-    INTCON3bits.INT2IE = 1;		// Enable INT2 interrupt (enableBT)
+    else SetupBluetooth();      // 115200 BAUD: full-rate frames do not fit in 9600
+    ProfStart();                // TMR1 free-running for the ISR budget profiler
+    hal_tmr0_start(RATE_T0PS);	// Turn on TMR0, prescaler for _XTAL_FREQ, see rate.h
+    hal_tmr0_ack();
+    hal_tmr0_irq(1);		// Enable TMR0 interrupt
+    hal_int_edge(0, 0);	// Set pin 33 (RB0/INT0) for negative edge trigger
+    hal_int_edge(1, 0);	// Set pin 34 (RB1/INT1) for negative edge trigger
+    if (enableBT) hal_int_edge(2, 0);	// Set pin 35 (RB2/INT2) for negative edge 
+    else hal_int_edge(2, 1);	// Set pin 35 (RB2/INT2) for positive edge 
+    hal_int_ack(0);	hal_int_ack(1);	hal_int_ack(2);	// Reset interrupt flags
+    hal_int_irq(0, 1);		// Enable INT0 interrupt (function down)
+    hal_int_irq(1, 1);		// Enable INT1 interrupt (function up)
+    hal_int_irq(2, 1);		// Enable INT2 interrupt (enableBT)
+    RxStart();                  // RCIE: commands from Bluetooth, see command.h
+    hal_irq_peripherals();      // PEIE: USART and TMR2 queue interrupts
+    hal_irq_enable();           // GIE
     function = 0;
     while (1) {
-        if (enableBT && PIR1bits.RCIF) {            // Wait until USART got data
-            temp = RCREG;                           // Read received data
-            PIR1bits.RCIF = 0;                      // Reset RC flag
-            if (temp == 1) {                        // 1 for increment
-                if (function >= 10) function = 0;	// Set function range 0-10
-                else function++;
-            }
-            if (temp == 2) {                        // 2 for decrement
-                if (function == 0) function = 10;	// Set function range 0-10
-                else function--;
-            }
-            if (function == 9) SetupADC(1);         // ECG comes from AN1 channel
-            else SetupADC(0);                       // Others come from AN0 channel
-            functionBT = function | 0xF0;           // function code for Android
-            update = 1;                             // Signal main() to update LCD display
-        }
-        if (update) {                   // The update flag is set by INT0 or INT1
-            INTCONbits.TMR0IE = 0;		// Disable TMR0 interrupt
-            update = 0;                 // Reset update flag
-            if (!enableBT) {
-                PrintNum(function, 8);	// Update the function number on LCD display
-                SetPosition(64);        // Go to beginning of Line 2;
-                switch (function) {
-                    case 0:  PrintLine((const unsigned char*)"Binary counter  ",16); break;
-                    case 1:  PrintLine((const unsigned char*)"ECG simulation  ",16); break;
-                    case 2:  PrintLine((const unsigned char*)"Echo (A/D - D/A)",16); break;
-                    case 3:  PrintLine((const unsigned char*)"Echo @ fs     Hz",16); break;
-                    case 4:  PrintLine((const unsigned char*)"Derivative      ",16); break;
-                    case 5:  PrintLine((const unsigned char*)"Low-pass filter ",16); break;
-                    case 6:  PrintLine((const unsigned char*)"Hi-freq enhance ",16); break;
-                    case 7:  PrintLine((const unsigned char*)"60Hz notch filtr",16); break;
-                    case 8:  PrintLine((const unsigned char*)"Median filter   ",16); break;
-                    case 9:  PrintLine((const unsigned char*)"HR =       bpm  ",16); break;
-                    case 10: PrintLine((const unsigned char*)"PhotoplethysomoG",16); break;
-                }
-                enableBT = PORTBbits.RB2;   // Check again for BLUETOOTH enabled
-            }
-            if (function) {
-                LEDcount = function << 4;   // display "function" at the LEDs
-                PORTB = LEDcount;
-            }
-            INTCONbits.TMR0IE = 1;          // Ensable TMR0 interrupt
-        }
-        switch (function) {
-        case 0:             // Function 0: Binary counter
-            LEDcount++;						// Upcounter
-            PORTB = LEDcount & 0b11110000;	// Mask out the lower 4 bits
-            PORTD = LEDcount;				// Output ramp to verify linearity of the D/A
-            Delay_ms(20);					// Delay to slow down the counting
-            if (enableBT) {
-                skipCount++;
-                if (skipCount == 2) {
-                    TransmitBT(functionBT);
-                    TransmitBT(LEDcount);
-                    TransmitBT(128);
-                    skipCount = 0;
-                }
-            }
-            break;
-        case 3:				// Function 3: Echo (vary rate)
-            INTCONbits.TMR0IE = 0;			// Disable TMR0 interrupt
-            if (counter1 != counter && !enableBT) {
-                temp = sampling[counter];
-                PrintNum(temp,74);
-                counter1 = counter;
-            }
-            INTCONbits.TMR0IE = 1;			// Enable TMR0 interrupt
-            break;
-        case 9:				// Function 9: Multiplication of Backward Differences (MOBD)
-            if (display && !enableBT){		// Display Heart Rate in 3 digits
-                hr = 12000/rri_count;		// 60/0.005 = 12000
-                rri_count = 0;				// Reset RRI counter
-                PrintNum(hr, 71);			// Isolates each digit and displays
-                display = 0;				// Reset display flag
-            }
-            break;
-        }
+        hal_spin();
+        if (SchedRun()) continue;
+        EeService();                    // Queued EEPROM records, one byte per 4 ms, when idle
+        Idle();                         // IDLE mode until the next interrupt, see idle.h
     }
 }
@@ -5,10 +5,19 @@
 /*********************************************************************************************/
 
 /**************************** Specify the chip that we are using *****************************/
-#include <p18cxxx.h>
+#include "hal.h"
 #include <math.h>
 #include <stdlib.h>
-#include <xc.h>
+#include "usart.h"
+#include "lcd.h"
+#include "fmt.h"
+#include "rate.h"
+#include "eelog.h"
+#include "sun.h"
+#include "servo.h"
+#include "sched.h"
+#include "timebase.h"
+#include "idle.h"
 
 /************************* Configure the Microcontroller PIC18f4525 **************************/
 #pragma config OSC = XT
@@ -23,493 +32,521 @@
 #pragma config DEBUG = OFF
 #pragma config LVP = OFF
 #pragma config STVREN = OFF
-#define _XTAL_FREQ 4000000
+                                // _XTAL_FREQ: see rate.h
 
 /******************************** Define Prototype Functions *********************************/
-void Delay_ms(unsigned int x);
-void Transmit(unsigned char value);
-void PrintNum(unsigned char value, unsigned char position);
-void PrintNum1(unsigned char value, unsigned char position);
-void PrintNum2(unsigned char value, unsigned char position);
-void SetupSerial();
 void ClearScreen();
 void Backlight(unsigned char state);
 void SetPosition(unsigned char position);
 void PrintLine(const unsigned char *string, unsigned char numChars);
-void PrintInt(int value, unsigned char position);
-void PrintInt1(int value, unsigned char position);
-void write_eeprom(unsigned char address, unsigned char data);
-unsigned char read_eeprom (unsigned short address); 
+void SaveState();
+void SunShow();
+void HomeShow(const unsigned char *msg);
+void HomeDone();
+void Track();
+void Redraw();
+void Buttons();
+void Clock();
 void interrupt isr(void);
 
 /************************************** Global variables *************************************/
-unsigned char mode, update1, motor_on, motor_plus, home_on;
+unsigned char mode, motor_on, home_on;
 unsigned char debounce0, debounce1, debounce2, debounce3;
-unsigned char LEDcount, output, output1, output2, counter, counter1, skipCount;
+unsigned char LEDcount, output, output1, output2, counter, counter1, skipCount, tick10;
 unsigned char temp, sec_cnt, update_day, update_hr, update_min, update_sec;
 unsigned char hr, min, sec, day_h, day_l, up, pan100, tilt100, stop_pan, stop_tilt;
+unsigned char moved;            // Jogged or moved since the position was last saved
+unsigned char drive;            // PORTD bits last written by the servo PWM
+unsigned char state[EE_DATA];   // EE_KEY_HELIO record, see eelog.h
+unsigned char tick_ms = 1;      // Length of the TMR0 period now running: 1 ms, or 10 when idle
+unsigned char next_ms = 1;      // and of the one after it, loaded from reload_h:reload_l
+unsigned char reload_h = RATE_HIGH(1000, 49), reload_l = RATE_LOW(1000, 49);
+unsigned char home_msg[5];      // Mode 4 status: WAIT, DONE or the axis and fault, 0 = none
+unsigned char task_redraw, task_clock;     // Posted tasks, see sched.h
+#define SUN_PERIOD      4       // Seconds between sun position updates
+#define BUTTON_TICKS    10      // Buttons and switches polled every 10 ms
+#define BUDGET_BUTTONS  2000    // Task budgets in cycles, see sched.h
+#define BUDGET_CLOCK    15000   // The sun position takes most of it
+#define BUDGET_REDRAW   6000
+#define PULSES(count, p100)     ((long)(count) * 100 + (p100))  // Hall pulses, see servo.h
 int day, pan_count, tilt_count;
+int pan_offset, tilt_offset;    // Learned in mode 3: counts minus the computed target
 
-void Delay_ms(unsigned int x){ 	/****** Generate a delay for x ms, assuming 4 MHz clock ******/
-    unsigned char y;
-    for(;x > 0; x--) for(y=0; y< 82;y++);
+void ClearScreen(){   /************************** Clear LCD Screen ***************************/
+    LcdReset();						// Frame buffer and display, see lcd.h
 }
 
-void Transmit(unsigned char value) {  /********** send an ASCII Character to USART ***********/
-    while(!PIR1bits.TXIF) continue;		// Wait until USART is ready
-    TXREG = value;						// Send the data
-    while (!PIR1bits.TXIF) continue;	// Wait until USART is ready
-    Delay_ms(4); // Give the LCD some time to listen to what we've got to say.
+void Backlight(unsigned char state){  /************* Turn LCD Backlight on/off ***************/
+    Transmit(124);
+    if (state) Transmit(0x9D);		// If state == 1, backlight on; ox96 for 73% on
+    else Transmit(0x81);			// otherwise, backlight off
 }
 
-void PrintNum(unsigned char value1, unsigned char position1){ /** Print number at position ***/
-    int units, tens, hundreds, thousands;
-    SetPosition(position1);			// Set at the present position
-    hundreds = value1 / 100;		// Get the hundreds digit, convert to ASCII and send
-    if (hundreds != 0) Transmit(hundreds + 48);
-    else Transmit(20);
-    value1 = value1 - hundreds * 100;
-    tens = value1 / 10;				// Get the tens digit, convert to ASCII and send
-    Transmit(tens + 48);
-    units = value1 - tens * 10;
-    Transmit(units + 48);			// Convert to ASCII and send
+void SetPosition(unsigned char position){ 	/********** Set LCD Cursor Position  *************/
+    LcdGoto(position);              // In the frame buffer: the display follows by difference
 }
 
-void PrintNum1(unsigned char value1, unsigned char position1){ /** Print number at position **/
-    int units, tens, hundreds, thousands;
-    SetPosition(position1);			// Set at the present position
-    hundreds = value1 / 100;		// Get the hundreds digit, convert to ASCII and send
-//    if (hundreds != 0) Transmit(hundreds + 48);
-//    else Transmit(20);
-    value1 = value1 - hundreds * 100;
-    tens = value1 / 10;				// Get the tens digit, convert to ASCII and send
-//    Transmit(tens + 48);
-    units = value1 - tens * 10;
-    Transmit(units + 48);			// Convert to ASCII and send
+void PrintLine(const unsigned char *string, unsigned char numChars){ /**** Print characters ****/
+    unsigned char count;
+    for (count=0; count<numChars; count++) LcdPut(string[count]);
 }
 
-void PrintNum2(unsigned char value1, unsigned char position1){ /** Print number at position **/
-    int units, tens, hundreds, thousands;
-    SetPosition(position1);			// Set at the present position
-    hundreds = value1 / 100;		// Get the hundreds digit, convert to ASCII and send
-//    if (hundreds != 0) Transmit(hundreds + 48);
-//    else Transmit(20);
-    value1 = value1 - hundreds * 100;
-    tens = value1 / 10;				// Get the tens digit, convert to ASCII and send
-    Transmit(tens + 48);
-    units = value1 - tens * 10;
-    Transmit(units + 48);			// Convert to ASCII and send
+void SaveState(){  /********* Day, time and position: one record, written in the background ***/
+    state[0] = day;         state[1] = day >> 8;
+    state[2] = hr;          state[3] = min;
+    state[4] = pan_count;   state[5] = pan_count >> 8;
+    state[6] = tilt_count;  state[7] = tilt_count >> 8;
+    state[8] = pan_offset;  state[9] = pan_offset >> 8;
+    state[10] = tilt_offset; state[11] = tilt_offset >> 8;
+    state[12] = idle_pct;   // Not read back: how long the battery lasts, see idle.h
+    EeLog(EE_KEY_HELIO, state, 13);  // Replaces a copy still queued: bursts cost one record
 }
 
-void SetupSerial(){  /*********** Set up the USART Asynchronous Transmit (pin 25) ************/
-// For LCD - use SPBRG = 25;  9600 BAUD at 4MHz: 4,000,000/(16x9600) - 1 = 25.04
-// For Bluetooth - use SPBRG = 1; 115200 BAUD at 4MHz: 4,000,000/(16x115200) - 1 = 1
-    TRISC = 0x80;					// Transmit and receive, 0xC0 if transmit only
-    SPBRG = 25;
-    TXSTAbits.TXEN = 1;				// Transmit enable
-    TXSTAbits.SYNC = 0;				// Asynchronous mode
-    RCSTAbits.CREN = 1;				// Continuous receive (receiver enabled)
-    RCSTAbits.SPEN = 1;				// Serial Port Enable
-    TXSTAbits.BRGH = 1;				// High speed baud rate
+void SunShow(){  /*********** Sun position and mirror targets for the time now, see sun.h ***/
+    int d;
+    unsigned char h, m, s;
+    hal_tmr0_irq(0);            // One consistent time from isr()
+    d = day;    h = hr;     m = min;    s = sec;
+    hal_tmr0_irq(1);
+    SunUpdate(d, h, m, s);      // Sets pan_target, tilt_target
+    if (mode == 0) {
+        SetPosition(76);        // Sun elevation in degrees
+        PrintLine((const unsigned char*)"E", 1);
+        LcdNum(77, SUN_CDEG(sun_el) / 100, 3, FMT_LEFT | FMT_DIGITS(2));
+    }
 }
 
-void ClearScreen(){   /************************** Clear LCD Screen ***************************/
-    Transmit(254);					// See datasheets for Serial LCD and HD44780
-    Transmit(0x01);					// Available on our course webpage
+void Track(){  /******************* Send both axes to the targets of SunShow(), plus offsets ***/
+    long pan, tilt;
+    pan = PULSES(pan_target + pan_offset, 0);
+    tilt = PULSES(tilt_target + tilt_offset, 0);
+    hal_tmr0_irq(0);            // ServoMove() shares the axis state with isr()
+    if (labs(pan - PULSES(pan_count, pan100)) > SERVO_BAND) {
+        ServoMove(SERVO_PAN, pan);
+        moved = 1;              // Saved when the move is over
+    }
+    if (labs(tilt - PULSES(tilt_count, tilt100)) > SERVO_BAND) {
+        ServoMove(SERVO_TILT, tilt);
+        moved = 1;
+    }
+    hal_tmr0_irq(1);
 }
 
-void Backlight(unsigned char state){  /************* Turn LCD Backlight on/off ***************/
-    Transmit(124);
-    if (state) Transmit(0x9D);		// If state == 1, backlight on; ox96 for 73% on
-    else Transmit(0x81);			// otherwise, backlight off
+void HomeShow(const unsigned char *msg){  /*************** Mode 4 status, kept on redraws ***/
+    unsigned char i;
+    for (i = 0; i < 5; i++) home_msg[i] = msg[i];
+    SetPosition(75);
+    PrintLine(home_msg, 5);
 }
 
-void SetPosition(unsigned char position){ 	/********** Set LCD Cursor Position  *************/
-    Transmit(254);
-    Transmit(128 + position);
+void HomeDone(){  /********************* Mode 4: both axes stopped, DONE or the first fault ***/
+    unsigned char axis;
+    home_on = 0;
+    hal_pin_write(B, 3, 0);
+    for (axis = SERVO_PAN; axis <= SERVO_TILT; axis++) {
+        if (servo_fault[axis]) {    // Counts not zeroed: keep the old ones
+            if (servo_fault[axis] == SERVO_STALLED) HomeShow((const unsigned char*)"P STL");
+            else HomeShow((const unsigned char*)"P TMO");
+            if (axis == SERVO_TILT) {
+                home_msg[0] = 'T';
+                SetPosition(75);
+                LcdPut('T');
+            }
+            return;
+        }
+    }
+    SaveState();
+    HomeShow((const unsigned char*)"DONE ");
 }
 
-void PrintLine(const unsigned char *string, unsigned char numChars){ /**** Print characters ****/
-    unsigned char count;
-    for (count=0; count<numChars; count++) Transmit(string[count]);
+void Redraw(){  /******* Mode and position line, posted by isr() on a mode or count change ***/
+    LcdNum(1, mode, 1, 0);
+    switch (mode) {
+        case 0: SetPosition(64);    // 0:auto
+        PrintLine((const unsigned char*)"P     T         ",16);
+        LcdNum(65, pan_count, 5, FMT_LEFT | FMT_DIGITS(2));
+        LcdNum(71, tilt_count, 5, FMT_LEFT | FMT_DIGITS(2));
+        break;
+    case 1: SetPosition(64);        // manual - pan
+        PrintLine((const unsigned char*)"P:              ",16);
+        LcdNum(67, pan_count, 5, FMT_LEFT | FMT_DIGITS(2));
+        break;
+    case 2: SetPosition(64);        // manual - tilt
+        PrintLine((const unsigned char*)"T:              ",16);
+        LcdNum(67, tilt_count, 5, FMT_LEFT | FMT_DIGITS(2));
+        break;
+    case 3: SetPosition(64);        // Learning mode
+        PrintLine((const unsigned char*)"Learn this      ",16);
+        break;
+    case 4: SetPosition(64);        // Home/reset
+        PrintLine((const unsigned char*)"Home/reset ",11);
+        if (home_msg[0]) PrintLine(home_msg, 5);
+        else PrintLine((const unsigned char*)"     ",5);
+        break;                
+    case 5: SetPosition(64);        // Set day of year
+        PrintLine((const unsigned char*)"Change Day      ",16);
+        break;
+    case 6: SetPosition(64);        // Set hour
+        PrintLine((const unsigned char*)"Change Hour     ",16);
+        break;
+    case 7: SetPosition(64);        // Set minute
+        PrintLine((const unsigned char*)"Change Min      ",16);
+        break;
+    }
 }
 
-void PrintInt(int value, unsigned char position){ /******** Print number at position *********/
-    int units, tens, hundreds, thousands;
-    SetPosition(position);				// Set at the present position
-    if (value > 9999) {
-        PrintLine((const unsigned char*)"Over", 4);
-        return;
+void Buttons(){  /*********** Every BUTTON_TICKS: switches, jogs, learn, homing, clock set ***/
+    if (!debounce2) {
+        stop_pan = hal_pin_read(D, 2);
+        if (stop_pan) debounce2 = 250;
+    }
+    if (!debounce3) {
+        stop_tilt = hal_pin_read(D, 3);
+        if (stop_tilt) debounce3 = 250;
+    }                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                               
+    if (!debounce1 && (mode == 1)) {    // pan motor +
+        motor_on = hal_pin_read(D, 1);
+        if (motor_on) {
+            servo_plus[SERVO_PAN] = 1;
+            hal_port_write(D, 0b00010000);
+            moved = 1;              // Saved when the jog ends
+            hal_pin_write(B, 3, 1);
+            debounce1 = 10;
+        }
+        else {
+            hal_pin_write(B, 3, 0);
+            hal_port_write(D, 0b00000000);
+        }
+    }
+    if (!debounce1 && (mode == 1) && !stop_pan) {    // pan motor -
+        motor_on = hal_pin_read(D, 0);
+        if (motor_on) {
+            servo_plus[SERVO_PAN] = 0;
+            hal_port_write(D, 0b00100000);
+            moved = 1;
+            hal_pin_write(B, 3, 1);
+            debounce1 = 10;
+        }
+        else {
+            hal_pin_write(B, 3, 0);
+            hal_port_write(D, 0b00000000);
+        }
     }
-    if (value < -9999) {
-        PrintLine((const unsigned char*)"Under", 5);
-        return;
+    if (!debounce1 && (mode == 2)) {    // tilt motor +
+        motor_on = hal_pin_read(D, 1);
+        if (motor_on) {
+            servo_plus[SERVO_TILT] = 1;
+            hal_port_write(D, 0b01000000);
+            moved = 1;
+            hal_pin_write(B, 3, 1);
+            debounce1 = 10;
+        }
+        else {
+            hal_pin_write(B, 3, 0);
+            hal_port_write(D, 0b00000000);
+        }
     }
-    if (value < 0) {
-        value = -value;
-        Transmit(45);               // - sign
+    if (!debounce1 && (mode == 2) && !stop_tilt) {    // tilt motor -
+        motor_on = hal_pin_read(D, 0);
+        if (motor_on) {
+            servo_plus[SERVO_TILT] = 0;
+            hal_port_write(D, 0b10000000);
+            moved = 1;
+            hal_pin_write(B, 3, 1);
+            debounce1 = 10;
+        }
+        else {
+            hal_pin_write(B, 3, 0);
+            hal_port_write(D, 0b00000000);
+        }
     }
-//    else Transmit(43);            // + sign
-    thousands = value / 1000;		// Get the thousands digit, convert to ASCII and send
-    if (thousands != 0) Transmit(thousands + 48);
-    value = value - thousands * 1000;
-    hundreds = value / 100;			// Get the hundreds digit, convert to ASCII and send
-    if (hundreds != 0) Transmit(hundreds + 48);
-    value = value - hundreds * 100;
-    tens = value / 10;				// Get the tens digit, convert to ASCII and send
-    Transmit(tens + 48);
-    units = value - tens * 10;
-    Transmit(units + 48);			// Convert to ASCII and send
-}
-
-void PrintInt2(int value, unsigned char position){ /******** Print number at position ********/
-    int units, tens, hundreds, thousands;
-    SetPosition(position);				// Set at the present position
-    if (value > 9999) {
-        PrintLine((const unsigned char*)"Over", 4);
-        return;
+    if (moved && !motor_on && !ServoBusy()) {   // Jog or move over: save the position once
+        moved = 0;
+        SaveState();
+    }
+    if (!debounce1 && (mode == 3)) {            // learn: the mirror is on target now
+        if (hal_pin_read(D, 1)) {
+            pan_offset = pan_count - pan_target;
+            tilt_offset = tilt_count - tilt_target;
+            SaveState();
+            SetPosition(75);
+            PrintLine((const unsigned char*)"SAVE",4);
+            debounce1 = 50;
+        }
+        else if (hal_pin_read(D, 0)) {          // go: try the learned offsets
+            Track();
+            SetPosition(75);
+            PrintLine((const unsigned char*)"GO  ",4);
+            debounce1 = 50;
+        }
+    }
+    if (mode == 4) {                            // home & reset, both axes at once
+        if (home_on) {
+            if (!ServoBusy()) HomeDone();       // isr() zeroed the counts at the switches
+        }
+        else {
+            home_on = hal_pin_read(D, 1);
+            if (home_on) {
+                hal_tmr0_irq(0);
+                ServoHome(SERVO_PAN);
+                ServoHome(SERVO_TILT);
+                hal_tmr0_irq(1);
+                hal_pin_write(B, 3, 1);
+                HomeShow((const unsigned char*)"WAIT ");
+            }
+        }
     }
-    if (value < -9999) {
-        PrintLine((const unsigned char*)"Under", 5);
-        return;
+    if (!debounce2 && (mode == 5)) {            // day +
+        up = hal_pin_read(D, 1);
+        if (up) {
+            day++;
+            if (day > 366) day = 0;
+            debounce2 = 20;
+            update_day = 1;
+        }
     }
-    if (value < 0) {
-        value = -value;
-        Transmit(45);
+    if (!debounce2 && (mode == 5)) {            // day -
+        up = hal_pin_read(D, 0);
+        if (up) {
+            day--;
+            if (day < 0) day = 366;
+            debounce2 = 20;
+            update_day = 1;
+        }
+    }
+    if (!debounce2 && (mode == 6)) {            // hr +
+        up = hal_pin_read(D, 1);
+        if (up) {
+            if (hr == 59) hr = 0;
+            else hr++;
+            debounce2 = 20;
+            update_hr = 1;
+        }
+    }
+    if (!debounce2 && (mode == 6)) {            // hr -
+        up = hal_pin_read(D, 0);
+        if (up) {
+            if (hr == 0) hr = 59;
+            else hr--;
+            debounce2 = 20;
+            update_hr = 1;
+        }
+    }
+    if (!debounce2 && (mode == 7)) {            // min +
+        up = hal_pin_read(D, 1);
+        if (up) {
+            if (min == 59) min = 0;
+            else min++;
+            debounce2 = 20;
+            update_min = 1;
+        }
+    }
+    if (!debounce2 && (mode == 7)) {            // min -
+        up = hal_pin_read(D, 0);
+        if (up) {
+            if (min == 0) min = 59;
+            else min--;
+            debounce2 = 20;
+            update_min = 1;
+        }
     }
-//    else Transmit(43);
-    thousands = value / 1000;		// Get the thousands digit, convert to ASCII and send
-    if (thousands != 0) Transmit(thousands + 48);
-    value = value - thousands * 1000;
-    hundreds = value / 100;			// Get the hundreds digit, convert to ASCII and send
-    Transmit(hundreds + 48);
-    value = value - hundreds * 100;
-    tens = value / 10;				// Get the tens digit, convert to ASCII and send
-    Transmit(tens + 48);
-    units = value - tens * 10;
-    Transmit(units + 48);			// Convert to ASCII and send
-}
-
-void write_eeprom(unsigned char address, unsigned char data) /******* Write to EEPROM ********/
-{
-    while (EECON1bits.WR);      // make sure it's not busy with an earlier write.                                 ... so try doing it directly as the datasheet defines.
-    EEADR = address;
-    EEDATA = data;
-    EECON1bits.EEPGD = 0;
-    EECON1bits.CFGS  = 0;
-    EECON1bits.WREN  = 1;
-    INTCONbits.GIE   = 0;
-    EECON2 = 0x55;              // required sequence start
-    EECON2 = 0xAA;
-    EECON1bits.WR    = 1;
-    INTCONbits.GIE   = 1;       // required sequence end
 }
 
-unsigned char read_eeprom (unsigned short address) /************ Read from EEPROM ************/
-{   while (EECON1bits.WR);      // make sure it's not busy with an earlier write.
-    EEADR = address;
-    EECON1bits.EEPGD = 0;
-    EECON1bits.CFGS  = 0;
-    EECON1bits.RD    = 1;
-    return (EEDATA);
+void Clock(){  /********** Posted each second by isr() and when a button changed the clock ***/
+    if (update_day) {
+        update_day = 0;
+        LcdNum(4, day, 3, FMT_ZERO);
+        SaveState();
+    }
+    if (update_hr) {
+        update_hr = 0;
+        LcdNum(8, hr, 2, FMT_ZERO);
+        SaveState();
+    }        
+    if (update_min) {
+        update_min = 0;
+        LcdNum(11, min, 2, FMT_ZERO);
+        SaveState();            // Once a minute: a new slot each time, see eelog.h
+    }
+    if (update_sec) {
+        update_sec = 0;
+        LcdNum(14, sec, 2, FMT_ZERO);
+        if (sec % SUN_PERIOD == 0) {
+            SunShow();
+            if (mode == 0 && sun_up) Track();   // auto: follow the sun
+        }
+    }
 }
 
 void interrupt isr(void) { /************ high priority interrupt service routine *************/
-    if (INTCONbits.TMR0IF == 1) {	// When there is a timer0 overflow, this loop runs
-        INTCONbits.TMR0IE = 0;		// Disable TMR0 interrupt
-        INTCONbits.TMR0IF = 0;		// Reset timer 0 interrupt flag to 0
-        TMR0H = 0xD9;       // Reload TMR0 for 10 ms count, Sampling rate = 240 Hz
-        TMR0L = 0x20;       // 0xFFFF-0x2710 = 0xD85F = 10,000 adjusted to D920
-        PORTCbits.RC0 = !PORTCbits.RC0; // Toggle pin 15;
-        sec_cnt++;
-        if (sec_cnt == 100) {
-            sec_cnt = 0;  sec++;  update_sec = 1;
-            if (sec == 60) {
-                sec = 0;    min++;  update_min = 1;
-                if (min == 60) {
-                    min = 0;    hr++;   update_hr = 1;
-                    if (hr == 24) {
-                        hr = 0; day++;  update_day = 1;
-                        if (day == 366) day = 0;
+    unsigned char ms, busy;
+    if (hal_tmr0_pending()) {	// When there is a timer0 overflow, this loop runs
+        hal_tmr0_irq(0);		// Disable TMR0 interrupt
+        hal_tmr0_ack();		// Reset timer 0 interrupt flag to 0
+        hal_tmr0_reload(reload_h, reload_l);	// next_ms, 1 kHz or 100 Hz, 49 cycles in
+        ms = tick_ms;                   // The period that just ended
+        tick_ms = next_ms;
+        SchedTicks(ms);                 // 1 ms ticks of main(), see sched.h
+        busy = drive || ServoBusy();
+        if (busy && tick_ms == 1) {     // Software PWM of the motors, see servo.h
+            drive = ServoPwm();
+            hal_port_write(D, drive);
+        }
+        tick10 += ms;
+        if (tick10 == 10) {             // The rest at 100 Hz
+            tick10 = 0;
+            if (ServoControl(SERVO_PAN, PULSES(pan_count, pan100), hal_pin_read(D, 2))) {
+                pan_count = 0;  pan100 = 0;     // At the home switch
+                SchedPost(task_redraw);
+            }
+            if (ServoControl(SERVO_TILT, PULSES(tilt_count, tilt100), hal_pin_read(D, 3))) {
+                tilt_count = 0; tilt100 = 0;
+                SchedPost(task_redraw);
+            }
+            hal_pin_toggle(C, 0);       // Toggle pin 15;
+            sec_cnt++;
+            if (sec_cnt == 100) {
+                sec_cnt = 0;  sec++;  update_sec = 1;
+                SchedPost(task_clock);
+                if (sec == 60) {
+                    sec = 0;    min++;  update_min = 1;
+                    if (min == 60) {
+                        min = 0;    hr++;   update_hr = 1;
+                        if (hr == 24) {
+                            hr = 0; day++;  update_day = 1;
+                            if (day == 366) day = 0;
+                        }
                     }
                 }
             }
+            if (debounce0) debounce0--;
+            if (debounce1) debounce1--;
+            if (debounce2) debounce2--;
+            if (debounce3) debounce3--;
         }
-        if (debounce0) debounce0--;
-        if (debounce1) debounce1--;
-        if (debounce2) debounce2--;
-        if (debounce3) debounce3--;
-        INTCONbits.TMR0IE = 1;		// Enable TMR0 interrupt
+        if (!busy && tick10 + tick_ms == 10) {  // No PWM: wake at 100 Hz only, see idle.h
+            next_ms = 10;                       // (from a 100 Hz tick, so the clock keeps time)
+            reload_h = RATE_HIGH(100, 49);  reload_l = RATE_LOW(100, 49);
+        }
+        else {
+            next_ms = 1;
+            reload_h = RATE_HIGH(1000, 49); reload_l = RATE_LOW(1000, 49);
+        }
+        hal_tmr0_irq(1);		// Enable TMR0 interrupt
     }
-    if (INTCONbits.INT0IF == 1) {	// INT0 (pin 33) negative edge - Pan Hall A
-        INTCONbits.INT0IE = 0;		// Disable interrupt
-        INTCONbits.INT0IF = 0;		// Reset interrupt flag
-        pan100++;
-        if (pan100 >= 100) {
-            pan100 = 0;
-            update1 = 1;
-            if (motor_plus) pan_count++;
-            else pan_count--;
+    if (hal_int_pending(0)) {	// INT0 (pin 33) negative edge - Pan Hall A
+        hal_int_irq(0, 0);		// Disable interrupt
+        hal_int_ack(0);		// Reset interrupt flag
+        if (servo_plus[SERVO_PAN]) {    // Every pulse, in the direction of the drive
+            if (++pan100 == 100) {
+                pan100 = 0;
+                pan_count++;
+                SchedPost(task_redraw);
+            }
+        }
+        else if (pan100-- == 0) {
+            pan100 = 99;
+            pan_count--;
+            SchedPost(task_redraw);
         }
-        INTCONbits.INT0IE = 1;		// Enable interrupt
+        hal_int_irq(0, 1);		// Enable interrupt
     }
-    if (INTCON3bits.INT1IF == 1) {	// INT1 (pin 34) negative edge - Tilt Hall A
-        INTCON3bits.INT1IE = 0;		// Disable interrupt
-        INTCON3bits.INT1IF = 0;		// Reset interrupt flag
-        tilt100++;
-        if (tilt100 >= 100) {
-            tilt100 = 0;
-            update1 = 1;
-            if (motor_plus) tilt_count++;
-            else tilt_count--;           
-        }        
-        INTCON3bits.INT1IE = 1;		// Enable interrupt
+    if (hal_int_pending(1)) {	// INT1 (pin 34) negative edge - Tilt Hall A
+        hal_int_irq(1, 0);		// Disable interrupt
+        hal_int_ack(1);		// Reset interrupt flag
+        if (servo_plus[SERVO_TILT]) {
+            if (++tilt100 == 100) {
+                tilt100 = 0;
+                tilt_count++;
+                SchedPost(task_redraw);
+            }
+        }
+        else if (tilt100-- == 0) {
+            tilt100 = 99;
+            tilt_count--;
+            SchedPost(task_redraw);
+        }
+        hal_int_irq(1, 1);		// Enable interrupt
     }
-    if (INTCON3bits.INT2IF == 1) {	// INT1 (pin 35) either edge - Advance mode 
-        INTCON3bits.INT2IE = 0;		// Disable interrupt
-        INTCON3bits.INT2IF = 0;		// Reset interrupt flag
+    if (hal_int_pending(2)) {	// INT1 (pin 35) either edge - Advance mode 
+        hal_int_irq(2, 0);		// Disable interrupt
+        hal_int_ack(2);		// Reset interrupt flag
         if (debounce0 == 0) {
-            if (mode == 4) home_on = 0; // leaving home/reset
+            if (mode == 4) {            // leaving home/reset
+                home_on = 0;
+                hal_pin_write(B, 3, 0);
+                home_msg[0] = 0;        // Blank status on the next visit
+            }
+            ServoStop();            // A new mode starts with the motors off
             mode++;
             if (mode == 8) mode = 0;
-            update1 = 1;
+            SchedPost(task_redraw);
             debounce0 = 10;			// Set switch debounce delay counter decremented by TMR0
         }
-        INTCON3bits.INT2IE = 1;		// Enable interrupt
+        hal_int_irq(2, 1);		// Enable interrupt
     }
+    TxService();                    // TXIF / TMR2: drain the USART transmit queues
+    TimeService();                  // TMR3: the time base, see timebase.h
 }
 
 void main(){   /****************************** Main program **********************************/
-    TRISB = 0b00010111;			// RB0-2, 4 as inputs, others outputs, RB3 drives red LED
-    TRISC = 0b00000000;			// RC0 as output, 100 Hz calibration
-    TRISD = 0b00001111;			// Set top 4 bits of port D as outputs to drive the motors
-    PORTD = 0;					// Set port D to 0's
+    hal_port_dir(B, 0b00010111);			// RB0-2, 4 as inputs, others outputs, RB3 drives red LED
+    hal_port_dir(C, 0b00000000);			// RC0 as output, 100 Hz calibration
+    hal_port_dir(D, 0b00001111);			// Set top 4 bits of port D as outputs to drive the motors
+    hal_port_write(D, 0);		// Set port D to 0's
     SetupSerial();				// Set up USART Asynchronous Transmit for LCD display
-    Delay_ms(100);	
+    TimeStart();                // TMR3 microseconds for DelayMs(), see timebase.h
+    hal_irq_enable();           // Let TxService() drain the LCD queue during the splash screen
+    DelayMs(100);
     Transmit(18);               // Ctl R to reset BAUD rate to 9600
-    Delay_ms(2500);				// Wait until the LCD display is ready
+    DelayMs(2500);				// Wait until the LCD display is ready
     Backlight(1);               // turn LCD display backlight on
     ClearScreen();              // Clear screen and set cursor to first position
     PrintLine((const unsigned char*)"  Heliostat 1", 13);
     SetPosition(64);            // Go to beginning of Line 2;
     PrintLine((const unsigned char*)"Motor Controller",16);	// Put your trademark here
-    Delay_ms(3000);
+    DelayMs(3000);
     ClearScreen();              // Clear screen and set cursor to first position
-    T0CON = 0b10001000;			// Turn on TMR0 and use the prescaler 000 (1:2))
-    INTCON = 0b10110000;		// GIE(7) = TMR0IE = INT0IE = 1
-    INTCONbits.TMR0IF = PIR1bits.TMR1IF = 0;
-    INTCONbits.TMR0IE = 1;		// Enable TMR0 interrupt
-    INTCON2bits.INTEDG0 = 0;	// Set pin 33 (RB0/INT0) for negative edge trigger
-    INTCON2bits.INTEDG1 = 0;	// Set pin 34 (RB1/INT1) for negative edge trigger
-    INTCONbits.INT0IF = INTCON3bits.INT1IF = INTCON3bits.INT2IF = 0;// Reset interrupt flags
-    INTCONbits.INT0IE = 1;		// Enable INT0 interrupt (mode down)
-    INTCON3bits.INT1IE = 1;		// Enable INT1 interrupt (mode up)
-    INTCON3bits.INT2IE = 1;		// Enable INT2 interrupt (mode)
+    ServoInit();
+    SchedInit();                // Tasks in priority order, see sched.h
+    SchedAdd(Buttons, BUTTON_TICKS, BUDGET_BUTTONS);
+    task_redraw = SchedAdd(Redraw, 0, BUDGET_REDRAW);
+    task_clock = SchedAdd(Clock, 0, BUDGET_CLOCK);      // Last: the sun position takes long
+    hal_tmr0_start(RATE_T0PS);	// Turn on TMR0, prescaler for _XTAL_FREQ, see rate.h
+    hal_tmr0_ack();
+    hal_tmr0_irq(1);		// Enable TMR0 interrupt
+    hal_int_edge(0, 0);	// Set pin 33 (RB0/INT0) for negative edge trigger
+    hal_int_edge(1, 0);	// Set pin 34 (RB1/INT1) for negative edge trigger
+    hal_int_ack(0);	hal_int_ack(1);	hal_int_ack(2);	// Reset interrupt flags
+    hal_int_irq(0, 1);		// Enable INT0 interrupt (mode down)
+    hal_int_irq(1, 1);		// Enable INT1 interrupt (mode up)
+    hal_int_irq(2, 1);		// Enable INT2 interrupt (mode)
+    hal_irq_peripherals();      // PEIE: USART and TMR2 queue interrupts
+    hal_irq_enable();           // GIE
     mode = 0;   motor_on = 0;   home_on = 0;    pan100 = 0;     tilt100 = 0;
-    day_l = read_eeprom(0);   day_h = read_eeprom(1);   hr = read_eeprom(2);   min = read_eeprom(3);
-    day = (unsigned int)day_h * 256 + day_l;
-    pan_count = read_eeprom(4); tilt_count = read_eeprom(5);
-    update1 = update_day = update_hr = update_min = update_sec = 1;	// update flags
+    EeInit();                   // Log-structured EEPROM store, see eelog.h
+    if (EeSetting(EE_KEY_HELIO, state)) {
+        day = state[0] | (unsigned int)state[1] << 8;   hr = state[2];   min = state[3];
+        pan_count = state[4] | (unsigned int)state[5] << 8;
+        tilt_count = state[6] | (unsigned int)state[7] << 8;
+        pan_offset = state[8] | (unsigned int)state[9] << 8;    // 0 in older records
+        tilt_offset = state[10] | (unsigned int)state[11] << 8;
+    }
+    else {                      // First start after the old firmware: bytes 0-5
+        day_l = EeReadByte(0);  day_h = EeReadByte(1);  hr = EeReadByte(2);  min = EeReadByte(3);
+        day = (unsigned int)day_h * 256 + day_l;
+        pan_count = EeReadByte(4); tilt_count = EeReadByte(5);
+    }
+    state[0] = ee_bad;          state[1] = ee_records;
+    EeLog(EE_EV_BOOT, state, 2);
+    update_day = update_hr = update_min = update_sec = 1;	// update flags
+    SchedPost(task_clock);
+    SchedPost(task_redraw);
     SetPosition(0);     PrintLine((const unsigned char*)"( )",3);
     while (1) {
-        if (update1) {			// The update flag is set by INT0 or INT1
-            update1 = 0;
-            PrintNum1(mode, 1);
-            switch (mode) {
-                case 0: SetPosition(64);    // 0:auto
-                PrintLine((const unsigned char*)"P     T         ",16);
-                PrintInt(pan_count, 65);
-                PrintInt(tilt_count, 71);
-                break;
-            case 1: SetPosition(64);        // manual - pan
-                PrintLine((const unsigned char*)"P:              ",16);
-                PrintInt(pan_count, 67);
-                write_eeprom(4, pan_count);
-                break;
-            case 2: SetPosition(64);        // manual - tilt
-                PrintLine((const unsigned char*)"T:              ",16);
-                PrintInt(tilt_count, 67);
-                write_eeprom(5, tilt_count);
-                break;
-            case 3: SetPosition(64);        // Learning mode
-                PrintLine((const unsigned char*)"Learn this      ",16);
-                break;
-            case 4: SetPosition(64);        // Home/reset
-                PrintLine((const unsigned char*)"Home/reset      ",16);
-                break;                
-            case 5: SetPosition(64);        // Set day of year
-                PrintLine((const unsigned char*)"Change Day      ",16);
-                break;
-            case 6: SetPosition(64);        // Set hour
-                PrintLine((const unsigned char*)"Change Hour     ",16);
-                break;
-            case 7: SetPosition(64);        // Set minute
-                PrintLine((const unsigned char*)"Change Min      ",16);
-                break;
-            }
-        }
-        if (!debounce2) {
-            stop_pan = PORTDbits.RD2;
-            if (stop_pan) debounce2 = 250;
-        }
-        if (!debounce3) {
-            stop_tilt = PORTDbits.RD3;
-            if (stop_tilt) debounce3 = 250;
-        }                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                               
-        if (!debounce1 && (mode == 1)) {    // pan motor +
-            motor_on = PORTDbits.RD1;
-            if (motor_on) {
-                motor_plus = 1;
-                PORTD = 0b00010000;
-                PORTBbits.RB3 = 1;
-                debounce1 = 10;
-            }
-            else {
-                PORTBbits.RB3 = 0;
-                PORTD = 0b00000000;
-            }
-        }
-        if (!debounce1 && (mode == 1) && !stop_pan) {    // pan motor -
-            motor_on = PORTDbits.RD0;
-            if (motor_on) {
-                motor_plus = 0;
-                PORTD = 0b00100000;
-                PORTBbits.RB3 = 1;
-                debounce1 = 10;
-            }
-            else {
-                PORTBbits.RB3 = 0;
-                PORTD = 0b00000000;
-            }
-        }
-        if (!debounce1 && (mode == 2)) {    // tilt motor +
-            motor_on = PORTDbits.RD1;
-            if (motor_on) {
-                motor_plus = 1;
-                PORTD = 0b01000000;
-                PORTBbits.RB3 = 1;
-                debounce1 = 10;
-            }
-            else {
-                PORTBbits.RB3 = 0;
-                PORTD = 0b00000000;
-            }
-        }
-        if (!debounce1 && (mode == 2) && !stop_tilt) {    // tilt motor -
-            motor_on = PORTDbits.RD0;
-            if (motor_on) {
-                motor_plus = 0;
-                PORTD = 0b10000000;
-                PORTBbits.RB3 = 1;
-                debounce1 = 10;
-            }
-            else {
-                PORTBbits.RB3 = 0;
-                PORTD = 0b00000000;
-            }
-        }
-        if (mode == 4) {                            // home & reset
-            if (home_on) {
-                PORTBbits.RB3 = 1;
-                PORTD = 0b00100000;
-                while (!stop_pan) stop_pan = PORTDbits.RD2;
-                PORTD = 0b10000000;
-                pan_count = 0;
-                write_eeprom(4, pan_count);
-                PORTD = 0b10000000;
-                while (!stop_tilt) stop_tilt = PORTDbits.RD3;
-                PORTD = 0b00000000;
-                tilt_count = 0;
-                write_eeprom(5, tilt_count);
-                PORTBbits.RB3 = 0;
-                home_on = 0;
-                SetPosition(75);
-                PrintLine((const unsigned char*)"DONE",4);
-                update1 = 0;
-            }
-            else {
-                home_on = PORTDbits.RD1;
-                if (home_on) {
-                    SetPosition(75);
-                    PrintLine((const unsigned char*)"WAIT",4);
-                }
-            }
-        }
-        if (!debounce2 && (mode == 5)) {            // day +
-            up = PORTDbits.RD1;
-            if (up) {
-                day++;
-                if (day > 366) day = 0;
-                debounce2 = 20;
-                update_day = 1;
-            }
-        }
-        if (!debounce2 && (mode == 5)) {            // day -
-            up = PORTDbits.RD0;
-            if (up) {
-                day--;
-                if (day < 0) day = 366;
-                debounce2 = 20;
-                update_day = 1;
-            }
-        }
-        if (!debounce2 && (mode == 6)) {            // hr +
-            up = PORTDbits.RD1;
-            if (up) {
-                if (hr == 59) hr = 0;
-                else hr++;
-                debounce2 = 20;
-                update_hr = 1;
-            }
-        }
-        if (!debounce2 && (mode == 6)) {            // hr -
-            up = PORTDbits.RD0;
-            if (up) {
-                if (hr == 0) hr = 59;
-                else hr--;
-                debounce2 = 20;
-                update_hr = 1;
-            }
-        }
-        if (!debounce2 && (mode == 7)) {            // min +
-            up = PORTDbits.RD1;
-            if (up) {
-                if (min == 59) min = 0;
-                else min++;
-                debounce2 = 20;
-                update_min = 1;
-            }
-        }
-        if (!debounce2 && (mode == 7)) {            // min -
-            up = PORTDbits.RD0;
-            if (up) {
-                if (min == 0) min = 59;
-                else min--;
-                debounce2 = 20;
-                update_min = 1;
-            }
-        }
-        if (update_day) {
-            update_day = 0;
-            PrintInt2(day, 4);
-            day_h = day / 256;
-            day_l = day - (unsigned int)day_h * 256;
-            write_eeprom(0, day_l);
-            write_eeprom(1, day_h);
-        }
-        if (update_hr) {
-            update_hr = 0;
-            PrintNum2(hr, 8);
-            write_eeprom(2, hr);
-        }        
-        if (update_min) {
-            update_min = 0;
-            PrintNum2(min, 11);
-            write_eeprom(3, min);
-        }
-        if (update_sec) {
-            update_sec = 0;
-            PrintNum2(sec, 14);
-        }
+        hal_spin();
+        if (SchedRun()) continue;
+        EeService();                    // Queued records, one byte per 4 ms, when idle
+        Idle();                         // IDLE mode until the next interrupt, see idle.h
     }
 }
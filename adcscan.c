@@ -0,0 +1,27 @@
+/*********************************************************************************************/
+/* adcscan.c - A/D scan sequencer, see adcscan.h                                             */
+/* Update history: 10/17/2026 initiated                                                      */
+/*********************************************************************************************/
+#include "hal.h"
+#include "adcscan.h"
+
+unsigned char scan_buf[SCAN_CHANNELS][SCAN_DEPTH];
+unsigned char scan_head;
+static unsigned char scan_set;
+
+void ScanSetup(unsigned char set){  /******************* Choose the channels to convert *******/
+    scan_set = set;
+}
+
+void ScanTick(){  /************* Convert every channel of the scan set into its ring ***********/
+    unsigned char ch, bit, head;
+    head = (scan_head + 1) & (SCAN_DEPTH - 1);
+    for (ch = 0, bit = 1; ch < SCAN_CHANNELS; ch++, bit <<= 1) {
+        if (!(scan_set & bit)) continue;
+        hal_adc_select(ch);                 // Clears ADIF; ACQT inserts 2 TAD of acquisition
+        hal_adc_start();
+        while (!hal_adc_done()) hal_spin();
+        scan_buf[ch][head] = hal_adc_result();
+    }
+    scan_head = head;                       // Publish the tick only once it is complete
+}
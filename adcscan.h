@@ -0,0 +1,30 @@
+/*********************************************************************************************/
+/* adcscan.h - A/D scan sequencer: a set of channels converted round-robin on every tick     */
+/* ScanTick() converts each channel of the scan set in turn (AN0 first) and appends the      */
+/* 8-bit results to one ring per channel, so the ISR reads any channel it needs without      */
+/* reconfiguring the A/D per function. The n channels of a tick are read within n x 26 us,  */
+/* e.g. ECG on AN1 and PPG on AN3 together for pulse transit time.                           */
+/* Update history: 10/17/2026 initiated                                                      */
+/*********************************************************************************************/
+#ifndef ADCSCAN_H
+#define ADCSCAN_H
+
+#define SCAN_CHANNELS   5           // AN0-AN4 are analog (ADCON1)
+#define SCAN_DEPTH      16          // Samples kept per channel, must be a power of 2
+
+#define SCAN_AN0        0x01        // Signal
+#define SCAN_AN1        0x02        // ECG
+#define SCAN_AN2        0x04        // Potentiometer
+#define SCAN_AN3        0x08        // PPG
+#define SCAN_AN4        0x10
+
+void ScanSetup(unsigned char set);  // Channels to convert from the next tick on
+void ScanTick();                    // Convert the scan set once, call from isr()
+
+extern unsigned char scan_buf[SCAN_CHANNELS][SCAN_DEPTH];
+extern unsigned char scan_head;     // Slot written by the last ScanTick()
+
+#define ScanLatest(ch)      (scan_buf[ch][scan_head])
+#define ScanPast(ch, age)   (scan_buf[ch][(scan_head - (age)) & (SCAN_DEPTH - 1)])
+
+#endif
@@ -0,0 +1,305 @@
+/*********************************************************************************************/
+/* bench.c - benchmark of the BME363 kernels (filter.c, dsp.c, median.c, pantompkins.c, ...) */
+/* Every kernel runs over every input and one CSV line is printed per pair:                  */
+/*                                                                                           */
+/*     kernel,input,samples,ns_per_sample,ksamples_per_s,cycles_per_sample                   */
+/*                                                                                           */
+/* Host build (make bench): best wall-clock time of 3 runs; cycles_per_sample is the         */
+/* hal_cost() model.                                                                         */
+/* Keep a run as a baseline and compare with "./bench -c baseline.csv": a ratio column is    */
+/* added and the exit status is 1 if any kernel got slower than the tolerance.               */
+/* Target build (XC8 project: bench.c, the kernels, usart.c, lcd.c, fmt.c): TMR1 counts     */
+/* the instruction cycles of 256 samples per pair and the table goes out on the USART at     */
+/* 9600 BAUD; ns_per_sample and ksamples_per_s are derived from the cycles at 4 MHz.         */
+/* Update history: 10/17/2026 initiated                                                      */
+/*********************************************************************************************/
+#include "filter.h"
+#include "dsp.h"
+#include "median.h"
+#include "pantompkins.h"
+#include "ecgsynth.h"
+
+#define BENCH_INPUTS    3           // Built-in inputs: noise, square, ecg
+
+struct kernel {
+    const char *name;
+    unsigned char (*step)(unsigned char x);
+    unsigned char window;           // Median window, 0 for the other kernels
+    unsigned char set;              // filter_sets[] entry of FilterStep
+};
+
+static unsigned char Echo(unsigned char x){ return x; }
+static unsigned char Synth(unsigned char x){ (void)x; return EcgStep(); }
+
+static const struct kernel kernels[] = {
+    { "echo",        Echo,        0, 0 },    // Call and loop overhead only
+    { "derivative",  FilterStep,  0, FILTER_DERIVATIVE },
+    { "lowpass",     FilterStep,  0, FILTER_LOWPASS },
+    { "hifreq",      FilterStep,  0, FILTER_HIFREQ },
+    { "notch",       FilterStep,  0, FILTER_NOTCH },
+    { "notch60iir",  FilterStep,  0, 4 },
+    { "notch50iir",  FilterStep,  0, 5 },
+    { "qrsband",     FilterStep,  0, 6 },
+    { "ecgband",     FilterStep,  0, 7 },
+    { "fir15",       FilterStep,  0, 8 },
+    { "median5",     DspMedian,   5, 0 },
+    { "median9",     DspMedian,   9, 0 },
+    { "median15",    DspMedian,   15, 0 },
+    { "median31",    DspMedian,   31, 0 },
+    { "mobd",        DspMOBD,     0, 0 },
+    { "pantompkins", PTStep,      0, 0 },
+    { "ecgsynth",    Synth,       0, 0 },    // Function 1, one 1 kHz tick per sample
+};
+#define KERNELS     (sizeof kernels / sizeof kernels[0])
+
+static const char *input_names[BENCH_INPUTS] = { "noise", "square", "ecg" };
+
+static void BenchReset(const struct kernel *k){  /******* Same starting state for every run ***/
+    data0 = data1 = 0;
+    DspMOBDInit();
+    MedianInit(k->window ? k->window : 9, 0);
+    FilterSelect(k->set);
+    PTInit();
+    EcgInit();
+}
+
+static void BenchInput(unsigned char *buf, unsigned long n, unsigned char which){
+    unsigned long i;
+    unsigned short lfsr = 0xACE1;
+    EcgInit();
+    ecg_opts = ECG_NOISE | ECG_WANDER;
+    for (i = 0; i < n; i++) {
+        if (which == 0) {                   // noise: 16-bit Galois LFSR
+            lfsr = (lfsr >> 1) ^ (-(lfsr & 1u) & 0xB400u);
+            buf[i] = (unsigned char)lfsr;
+        }
+        else if (which == 1) buf[i] = (i / 24) & 1 ? 200 : 60;  // square: 5 Hz at 240 Hz
+        else {                              // ecg: function 1 at 70 bpm, every 5th ms: 200 Hz
+            EcgStep(); EcgStep(); EcgStep(); EcgStep();
+            buf[i] = EcgStep();
+        }
+    }
+    ecg_opts = 0;
+}
+
+#ifdef HOST_SIM
+/************************************* Host: wall clock **************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_RUNS  3               // Timed runs per pair, the fastest is reported
+
+static unsigned long cost;
+
+void sim_cost(unsigned int n) { cost += n; }    // hal_cost() of the kernels lands here
+
+struct result { char kernel[32], input[64]; double ns; };
+static struct result baseline[256];
+static int baselines;
+
+static void load_baseline(const char *file) {
+    FILE *f = fopen(file, "r");
+    char line[256];
+    struct result *r;
+    if (!f) { perror(file); exit(2); }
+    while (fgets(line, sizeof line, f) && baselines < 256) {
+        r = &baseline[baselines];
+        if (sscanf(line, "%31[^,],%63[^,],%*[^,],%lf", r->kernel, r->input, &r->ns) == 3) baselines++;
+    }
+    fclose(f);
+}
+
+static double baseline_ns(const char *kernel, const char *input) {
+    int i;
+    for (i = 0; i < baselines; i++)
+        if (!strcmp(baseline[i].kernel, kernel) && !strcmp(baseline[i].input, input))
+            return baseline[i].ns;
+    return 0;
+}
+
+static unsigned char *load_file(const char *name, unsigned long *n) {  /* raw or .csv/.txt */
+    FILE *f = fopen(name, "rb");
+    const char *dot = strrchr(name, '.');
+    unsigned long cap = 4096;
+    unsigned char *buf = malloc(cap);
+    char line[256];
+    int c, v, text = dot && (!strcmp(dot, ".csv") || !strcmp(dot, ".txt"));
+    if (!f) { perror(name); exit(2); }
+    *n = 0;
+    for (;;) {
+        if (text) {
+            if (!fgets(line, sizeof line, f)) break;
+            if (sscanf(line, "%d", &v) != 1) continue;
+            c = v < 0 ? 0 : v > 255 ? 255 : v;
+        }
+        else if ((c = fgetc(f)) == EOF) break;
+        if (*n == cap) buf = realloc(buf, cap *= 2);
+        buf[(*n)++] = (unsigned char)c;
+    }
+    fclose(f);
+    if (!*n) { fprintf(stderr, "bench: %s is empty\n", name); exit(2); }
+    return buf;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+        "usage: %s [options] [recording ...]\n"
+        "  -n samples   per kernel and input (default 1000000)\n"
+        "  -k name      only kernels whose name starts with this, e.g. -k median\n"
+        "  -c file      compare with an earlier run, exit 1 on a regression\n"
+        "  -T percent   regression tolerance for -c (default 15)\n"
+        "recordings are raw 8-bit or .csv/.txt and are repeated to fill the sample count\n",
+        prog);
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    unsigned long n = 1000000, len, i;
+    unsigned char *in, *src;
+    const char *only = NULL, *name;
+    double tolerance = 15, ns, t, base;
+    struct timespec t0, t1;
+    volatile unsigned char sink;
+    unsigned int k;
+    int opt, input, inputs, run, slower = 0;
+    while ((opt = getopt(argc, argv, "n:k:c:T:")) != -1) {
+        switch (opt) {
+        case 'n': n = strtoul(optarg, NULL, 0); break;
+        case 'k': only = optarg; break;
+        case 'c': load_baseline(optarg); break;
+        case 'T': tolerance = atof(optarg); break;
+        default: usage(argv[0]);
+        }
+    }
+    if (!n) usage(argv[0]);
+    in = malloc(n);
+    inputs = BENCH_INPUTS + argc - optind;
+    printf("kernel,input,samples,ns_per_sample,ksamples_per_s,cycles_per_sample%s\n",
+           baselines ? ",vs_baseline" : "");
+    for (input = 0; input < inputs; input++) {
+        if (input < BENCH_INPUTS) {
+            BenchInput(in, n, input);
+            name = input_names[input];
+        }
+        else {
+            name = argv[optind + input - BENCH_INPUTS];
+            src = load_file(name, &len);
+            for (i = 0; i < n; i++) in[i] = src[i % len];
+            free(src);
+            if (strrchr(name, '/')) name = strrchr(name, '/') + 1;
+        }
+        for (k = 0; k < KERNELS; k++) {
+            if (only && strncmp(kernels[k].name, only, strlen(only))) continue;
+            ns = 0;
+            for (run = 0; run < BENCH_RUNS; run++) {    // Best of BENCH_RUNS: least disturbed
+                BenchReset(&kernels[k]);
+                cost = 0;
+                clock_gettime(CLOCK_MONOTONIC, &t0);
+                for (i = 0; i < n; i++) sink = kernels[k].step(in[i]);
+                clock_gettime(CLOCK_MONOTONIC, &t1);
+                t = ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / n;
+                if (!run || t < ns) ns = t;
+            }
+            printf("%s,%s,%lu,%.2f,%.0f,%.1f", kernels[k].name, name, n, ns, 1e6 / ns,
+                   cost / (double)n);
+            if (baselines) {
+                base = baseline_ns(kernels[k].name, name);
+                if (base > 0) {
+                    printf(",%.2f", ns / base);
+                    if (ns > base * (1 + tolerance / 100)) slower = 1;
+                }
+                else printf(",");
+            }
+            printf("\n");
+        }
+    }
+    (void)sink;
+    return slower;
+}
+
+#else
+/*********************************** PIC18: TMR1 cycles *************************************/
+#include "hal.h"
+#include "usart.h"
+#include "fmt.h"
+
+#pragma config OSC = XT
+#pragma config WDT = OFF
+#pragma config PWRT = OFF
+#pragma config FCMEN = OFF
+#pragma config IESO = OFF
+#pragma config BOREN = ON
+#pragma config BORV = 2
+#pragma config WDTPS = 128
+#pragma config PBADEN = OFF
+#pragma config DEBUG = OFF
+#pragma config LVP = OFF
+#pragma config STVREN = OFF
+
+#define BENCH_N     256             // Samples per kernel and input
+#define BENCH_CHUNK 8               // TMR1 read every 8 samples: < 65536 cycles up to 8k/sample
+
+unsigned char bench_in[BENCH_N];
+
+void interrupt isr(void) {
+    TxService();
+}
+
+static void BenchPut(unsigned char c){  /********** Queue one byte, waiting for room *********/
+    while (!TxBTFree()) hal_spin();
+    TransmitBT(c);
+}
+
+static void BenchText(const char *s){
+    while (*s) BenchPut(*s++);
+}
+
+static void BenchNum(unsigned long value){  /******************************** Plain decimal ***/
+    unsigned char digits[FMT_MAX], n, i;
+    n = FmtNum(digits, value, 0, FMT_UNSIGNED);
+    for (i = 0; i < n; i++) BenchPut(digits[i]);
+}
+
+void main(){
+    unsigned char input, k, j;
+    unsigned int i;
+    unsigned short t0;
+    unsigned long cycles;
+    hal_port_dir(D, 0);
+    SetupSerial();              // 9600 BAUD, queues drained by isr()
+    hal_tmr1_start();
+    hal_irq_enable();
+    BenchText("kernel,input,samples,ns_per_sample,ksamples_per_s,cycles_per_sample\r\n");
+    for (input = 0; input < BENCH_INPUTS; input++) {
+        BenchInput(bench_in, BENCH_N, input);
+        for (k = 0; k < KERNELS; k++) {
+            BenchReset(&kernels[k]);
+            while (TxBTFree() < BT_QSIZE - 1) hal_spin();   // No TXIF interrupts while timing
+            hal_irq_disable();
+            cycles = 0;
+            for (i = 0; i < BENCH_N; i += BENCH_CHUNK) {
+                t0 = hal_tmr1_read();
+                for (j = 0; j < BENCH_CHUNK; j++) hal_dac_write(kernels[k].step(bench_in[i + j]));
+                cycles += (unsigned short)(hal_tmr1_read() - t0);
+            }
+            hal_irq_enable();
+            BenchText(kernels[k].name);
+            BenchPut(',');
+            BenchText(input_names[input]);
+            BenchPut(',');
+            BenchNum(BENCH_N);
+            BenchPut(',');
+            BenchNum(cycles * 1000 / BENCH_N);      // 1 cycle = 1000 ns at 4 MHz
+            BenchPut(',');
+            BenchNum(1000UL * BENCH_N / cycles);
+            BenchPut(',');
+            BenchNum(cycles / BENCH_N);
+            BenchText("\r\n");
+        }
+    }
+    while (1) hal_spin();
+}
+#endif
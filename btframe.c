@@ -0,0 +1,75 @@
+/*********************************************************************************************/
+/* btframe.c - framed Bluetooth sample stream, see btframe.h                                 */
+/* Update history: 10/17/2026 initiated                                                      */
+/*********************************************************************************************/
+#include "hal.h"
+#include "btframe.h"
+#include "usart.h"
+
+static unsigned char frame[2 * FRAME_SAMPLES];  // raw, out pairs of the frame being filled
+static unsigned char frame_n, frame_code;
+unsigned char frame_seq, frame_drops, frame_stream = 1;
+
+void FrameReset(){  /******************* Drop the partial frame, sequence back to 0 ***********/
+    frame_n = frame_seq = frame_drops = 0;
+}
+
+void FrameFlush(){  /******************* Queue the frame being filled, whole or not at all *****/
+    unsigned char k, sum;
+    if (!frame_n) return;
+    if (TxBTFree() < FRAME_BYTES(frame_n)) frame_drops++;
+    else {
+        TransmitBT(FRAME_SYNC0);
+        TransmitBT(FRAME_SYNC1);
+        TransmitBT(frame_code);
+        TransmitBT(frame_seq);
+        TransmitBT(frame_n);
+        sum = frame_code + frame_seq + frame_n;
+        for (k = 0; k < 2 * frame_n; k++) {
+            TransmitBT(frame[k]);
+            sum += frame[k];
+        }
+        TransmitBT(-sum);
+    }
+    frame_seq++;
+    frame_n = 0;
+}
+
+void FrameReply(unsigned char code, const unsigned char *data, unsigned char len){  /** Event **/
+    unsigned char k, sum;
+    FrameFlush();                       // Keep the samples before the event in order
+    if (TxBTFree() < len + 7) frame_drops++;
+    else {
+        TransmitBT(FRAME_SYNC0);
+        TransmitBT(FRAME_SYNC1);
+        TransmitBT(code);
+        TransmitBT(frame_seq);
+        TransmitBT(0);
+        TransmitBT(len);
+        sum = code + frame_seq + len;
+        for (k = 0; k < len; k++) {
+            TransmitBT(data[k]);
+            sum += data[k];
+        }
+        TransmitBT(-sum);
+    }
+    frame_seq++;
+}
+
+void FrameRecord(unsigned char code, const unsigned char *data, unsigned char len){  /* Event */
+    if (frame_stream) FrameReply(code, data, len);
+}
+
+void FrameStream(unsigned char on){  /************** Start or stop samples and events *********/
+    frame_n = 0;                        // A stopped stream restarts with a fresh frame
+    frame_stream = on;
+}
+
+void FrameSample(unsigned char code, unsigned char raw, unsigned char out){  /* Add one pair */
+    if (!frame_stream) return;
+    if (frame_n && code != frame_code) FrameFlush();    // Never mix functions in one frame
+    frame_code = code;
+    frame[2 * frame_n] = raw;
+    frame[2 * frame_n + 1] = out;
+    if (++frame_n == FRAME_SAMPLES) FrameFlush();
+}
@@ -0,0 +1,46 @@
+/*********************************************************************************************/
+/* btframe.h - framed Bluetooth sample stream                                                */
+/* The ISR hands every sample to FrameSample(); once FRAME_SAMPLES are collected the frame   */
+/* is copied into the Bluetooth queue in one piece and TXIF drains it in the background:     */
+/*                                                                                           */
+/*     0xA5 0x5A code seq n raw0 out0 raw1 out1 ... raw(n-1) out(n-1) check                  */
+/*                                                                                           */
+/* code  function code (0xF0 | function)                                                     */
+/* seq   frame counter, +1 per frame built, so a gap on the receiver means a lost frame      */
+/* n     sample pairs in this frame, 1..FRAME_SAMPLES (short when the function changes)      */
+/* check makes the 8-bit sum of code..check zero                                             */
+/*                                                                                           */
+/* FrameRecord() sends an event instead of samples, n = 0 followed by its length:            */
+/*                                                                                           */
+/*     0xA5 0x5A code seq 0 len data0 ... data(len-1) check                                  */
+/*                                                                                           */
+/* e.g. a QRS from function 12: R-wave sample number (4 bytes) and RR interval in samples    */
+/* (2 bytes), little endian; from function 9: mean heart rate, rr_status, rr_n and the RR    */
+/* history, newest first (2 bytes each), see dsp.h; from function 10 at each pulse: interval */
+/* in samples, red AC and DC, IR AC and DC (2 bytes each) and R x 100 (1 byte), see ppg.h.   */
+/*                                                                                           */
+/* A frame that does not fit in the queue is dropped whole and counted in frame_drops; its   */
+/* sequence number is still used up.                                                         */
+/*                                                                                           */
+/* FrameStream(0) stops samples and events until FrameStream(1); FrameReply() answers to     */
+/* commands (command.h) in the event format and goes out either way.                         */
+/* Update history: 10/17/2026 initiated                                                      */
+/*********************************************************************************************/
+#ifndef BTFRAME_H
+#define BTFRAME_H
+
+#define FRAME_SYNC0     0xA5
+#define FRAME_SYNC1     0x5A
+#define FRAME_SAMPLES   8           // Sample pairs per frame: 22 bytes, 1.9 ms at 115200
+#define FRAME_BYTES(n)  (2 * (n) + 6)
+
+void FrameSample(unsigned char code, unsigned char raw, unsigned char out);
+void FrameFlush();                  // Send the partial frame now
+void FrameReset();                  // Forget the partial frame, restart seq at 0
+void FrameRecord(unsigned char code, const unsigned char *data, unsigned char len);
+void FrameReply(unsigned char code, const unsigned char *data, unsigned char len);
+void FrameStream(unsigned char on); // Samples and events on (default) or off
+
+extern unsigned char frame_seq, frame_drops, frame_stream;
+
+#endif
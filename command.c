@@ -0,0 +1,64 @@
+/*********************************************************************************************/
+/* command.c - framed commands received over Bluetooth, see command.h                        */
+/* A byte-at-a-time state machine, so a frame may arrive over any number of calls.           */
+/* Update history: 10/17/2026 initiated                                                      */
+/*********************************************************************************************/
+#include "command.h"
+#include "btframe.h"
+#include "usart.h"
+
+#define CMD_IDLE        0           // Parser states
+#define CMD_SYNC        1
+#define CMD_CODE        2
+#define CMD_LEN         3
+#define CMD_DATA        4
+#define CMD_CHECK       5
+
+unsigned char cmd_len, cmd_data[CMD_MAX], cmd_errors;
+static unsigned char state, code, n, sum;
+
+unsigned char CmdPoll(){  /******************* Parse the received bytes up to one command ****/
+    unsigned char c;
+    while (RxReady()) {
+        c = RxGet();
+        switch (state) {
+        case CMD_IDLE:
+            if (c == FRAME_SYNC0) state = CMD_SYNC;
+            else if (c >= 1 && c <= 9) {    // One-byte command
+                cmd_len = 0;
+                return c;
+            }
+            break;
+        case CMD_SYNC:
+            if (c == FRAME_SYNC1) state = CMD_CODE;
+            else if (c != FRAME_SYNC0) state = CMD_IDLE;
+            break;
+        case CMD_CODE:
+            code = sum = c;
+            state = CMD_LEN;
+            break;
+        case CMD_LEN:
+            if (c > CMD_MAX) {
+                cmd_errors++;
+                state = CMD_IDLE;
+                break;
+            }
+            cmd_len = c;
+            sum += c;
+            n = 0;
+            state = c ? CMD_DATA : CMD_CHECK;
+            break;
+        case CMD_DATA:
+            cmd_data[n++] = c;
+            sum += c;
+            if (n == cmd_len) state = CMD_CHECK;
+            break;
+        case CMD_CHECK:
+            state = CMD_IDLE;
+            if ((unsigned char)(sum + c)) cmd_errors++;
+            else if (code) return code;
+            break;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,60 @@
+/*********************************************************************************************/
+/* command.h - framed commands received over Bluetooth                                       */
+/* Bytes come out of the USART receive ring (usart.h) and are framed like the sample stream: */
+/*                                                                                           */
+/*     0xA5 0x5A code len data0 ... data(len-1) check                                        */
+/*                                                                                           */
+/* check makes the 8-bit sum of code..check zero. Outside a frame a single byte 1-9 is the   */
+/* old one-byte command of the Android app and is returned as is.                            */
+/*                                                                                           */
+/* code              data                       action                                       */
+/* CMD_FUNCTION      n                          go to function n (0-12)                      */
+/* CMD_RATE          Hz (2 bytes)               sampling rate of functions 2 and 4-8 (16-    */
+/*                                              1000 Hz) until the function changes; the     */
+/*                                              detectors of 9 and 12 are built for 200 Hz   */
+/* CMD_THRESHOLD     threshold (2 bytes)        fixed MOBD threshold of function 9, at least */
+/*                                              MOBD_FLOOR, or 0 for adaptive (default), see */
+/*                                              dsp.h                                        */
+/* CMD_FILTER        set                        filter set of functions 4-7, see filter.h    */
+/* CMD_FIR           shift h(0) .. h(n-1)       load FILTER_USER as an FIR and select it     */
+/* CMD_BIQUAD        b0 b1 b2 a1 a2 (2 bytes    load FILTER_USER as biquads and select it    */
+/*                   each) per section                                                       */
+/* CMD_STREAM        0 or 1                     stop or start samples and events             */
+/* CMD_STATS         -                          reply with CMD_STATS_LEN bytes, see below    */
+/* CMD_LOG           n                          reply with the EEPROM record n back from the */
+/*                                              newest (EE_SLOT bytes), see eelog.h          */
+/*                                                                                           */
+/* 2-byte values are little endian. Every framed command is answered by a FrameReply() with  */
+/* code | CMD_REPLY: one byte, CMD_OK or CMD_BAD, the record for CMD_LOG, or for CMD_STATS   */
+/*   function, filter set, threshold (2), rate in Hz (2, 0 if not block-processed),          */
+/*   frame_drops, tx_drops, rx_drops, cmd_errors, block_overruns, block_underruns, stream    */
+/* Frames with a bad check or a len over CMD_MAX are dropped and counted in cmd_errors.      */
+/* Update history: 10/17/2026 initiated                                                      */
+/*********************************************************************************************/
+#ifndef COMMAND_H
+#define COMMAND_H
+
+#define CMD_MAX         48          // Longest data: 4 biquad sections
+
+#define CMD_FUNCTION    0x10
+#define CMD_RATE        0x11
+#define CMD_THRESHOLD   0x12
+#define CMD_FILTER      0x13
+#define CMD_FIR         0x14
+#define CMD_BIQUAD      0x15
+#define CMD_STREAM      0x16
+#define CMD_STATS       0x17
+#define CMD_LOG         0x18
+
+#define CMD_REPLY       0x80        // Added to the code of the reply
+#define CMD_OK          0
+#define CMD_BAD         1           // Wrong length or value out of range, nothing changed
+#define CMD_STATS_LEN   13
+
+unsigned char CmdPoll();            // Next command code from the receive ring, 0 if none yet
+
+extern unsigned char cmd_len;       // Data bytes of the command CmdPoll() returned
+extern unsigned char cmd_data[CMD_MAX];
+extern unsigned char cmd_errors;
+
+#endif
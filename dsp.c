@@ -0,0 +1,134 @@
+/*********************************************************************************************/
+/* dsp.c - per-sample kernels of BME363 functions 8 and 9, see dsp.h                         */
+/* Moved out of isr() unchanged, including the in-place sign flip of the MOBD differences.  */
+/* Threshold and RR bookkeeping only run at the end of a peak or at a detection, so the      */
+/* per-sample cost is a few compares.                                                        */
+/* Update history: 10/17/2026 initiated                                                      */
+/*********************************************************************************************/
+#include "hal.h"
+#include "dsp.h"
+#include "median.h"
+
+unsigned char data0, data1, refractory;
+short mobd;
+int threshold, rri_count;
+int mobd_fixed, mobd_spk, mobd_npk;
+int rr_hist[RR_HIST];
+unsigned char rr_n, rr_status, mobd_hr;
+static short m0, m1, m2;                // Backward differences, newest first
+static int peak;                        // Largest mobd of the current bump
+static int quiet;                       // Samples since the last detection or halving of SPK
+static int rr_sum;                      // Sum of rr_hist[0 .. rr_n-1]
+static unsigned char rr_valid, rr_rejects;  // rri_count is an interval, outliers in a row
+
+static void MOBDLevel(){  /*************************** Threshold from the two peak levels *****/
+    if (mobd_fixed) threshold = mobd_fixed;
+    else {
+        threshold = mobd_npk + ((mobd_spk - mobd_npk) >> 3);
+        if (threshold < MOBD_FLOOR) threshold = MOBD_FLOOR;
+    }
+}
+
+void DspMOBDThreshold(int fixed){  /******************** Fixed value or back to adaptive ***/
+    if (fixed && fixed < MOBD_FLOOR) fixed = MOBD_FLOOR;    // E.g. a bad EEPROM record
+    mobd_fixed = fixed;
+    MOBDLevel();                        // The peak levels kept running either way
+}
+
+void DspMOBDInit(){  /****************************** Start over, e.g. on entry to function 9 ***/
+    m0 = m1 = m2 = 0;
+    refractory = 0;
+    peak = quiet = 0;
+    mobd_spk = 512;                     // Threshold 128 to begin with, the old constant
+    mobd_npk = 0;
+    MOBDLevel();
+    rri_count = 0;
+    rr_valid = rr_rejects = 0;
+    rr_n = rr_status = mobd_hr = 0;
+    rr_sum = 0;
+}
+
+static void MOBDBeat(){  /************************** Classify the RR interval of a detection ***/
+    unsigned char k;
+    int rr, mean;
+    rr = rri_count;
+    rri_count = quiet = 0;
+    if (!rr_valid || rr > RR_MAX) {     // Nothing to measure from
+        rr_valid = 1;
+        rr_status = RR_NONE;
+        return;
+    }
+    hal_cost(120);                      // Cycle model: the division below, once per beat
+    mean = rr_n ? rr_sum / rr_n : rr;
+    if (rr_n && (rr < mean - (mean >> 2) || rr > mean + (mean >> 1))) {
+        rr_status = RR_OUTLIER;         // Extra or missed beat, or the rhythm changed
+        if (++rr_rejects < 4) return;
+        rr_n = rr_sum = 0;              // Changed: start the history over
+        rr_status = RR_RESTART;
+    }
+    else rr_status = RR_OK;
+    rr_rejects = 0;
+    if (rr_n == RR_HIST) rr_sum -= rr_hist[--rr_n];
+    for (k = rr_n; k > 0; k--) rr_hist[k] = rr_hist[k - 1];
+    rr_hist[0] = rr;
+    rr_sum += rr;
+    rr_n++;
+    rr = 12000 / (rr_sum / rr_n);       // 60/0.005 = 12000
+    mobd_hr = rr > 255 ? 255 : rr;
+}
+
+unsigned char DspMedian(unsigned char x){  /************************** Sliding-window median ***/
+    data0 = x;
+    return MedianPush(data0);	// Sliding window of the last median_size points
+}
+
+unsigned char DspMOBD(unsigned char x){  /****** Multiplication of Backward Differences *******/
+    data1 = data0;			// Move old ECG sample to data1
+    data0 = x;
+    m2 = m1;					// Move oldest difference to m2
+    m1 = m0;					// Move older difference to m1
+    m0 = (int)data0 - data1;	// Store new difference in m0, (int) casting important
+    rri_count++;				// Increment RR-interval
+    mobd = 0;					// mobd = 0, unless sign consistency is met:
+    if (m0 > 0 && m1 > 0 && m2 > 0){	// (1) If 3 consecutive positive differences
+        mobd = m0 * m1;			// Multiply first two differences
+        mobd = mobd * m2;		// Multiply the oldest difference
+        hal_cost(2 * 36);       // Cycle model: two 16 x 16 multiplies
+    }
+    if (m0 < 0 && m1 < 0 && m2 < 0){	// (2) If 3 consecutive negative differences
+        m0 = -m0;				// Take absolute value of differences
+        m1 = -m1;
+        m2 = -m2;
+        mobd = m0 * m1;			// Multiply first two differences
+        mobd = mobd * m2;		// Multiply the oldest difference
+        hal_cost(2 * 36);       // Cycle model: two 16 x 16 multiplies
+    }
+    if (refractory){			// Avoid detecting extraneous peaks after QRS
+        if (mobd > peak) peak = mobd;	// Height of this QRS
+        refractory++;
+        if (refractory == MOBD_REFRACTORY) {	// Delay for 200 ms
+            refractory = 0;
+            mobd_spk = mobd_spk - (mobd_spk >> 3) + (peak >> 3);	// SPK = 0.125 PEAK + 0.875 SPK
+            peak = 0;
+            MOBDLevel();
+        }
+    }
+    else if (mobd > threshold) {	// A peak is detected
+        refractory = 1;
+        peak = mobd;
+        MOBDBeat();
+    }
+    else if (mobd > peak) peak = mobd;	// A bump below the threshold
+    else if (!mobd && peak) {			// and its end: a noise peak
+        mobd_npk = mobd_npk - (mobd_npk >> 3) + (peak >> 3);	// NPK = 0.125 PEAK + 0.875 NPK
+        peak = 0;
+        MOBDLevel();
+    }
+    if (++quiet == RR_MAX) {			// Nothing for 2 s: the QRS got smaller
+        quiet = 0;
+        mobd_spk >>= 1;
+        MOBDLevel();
+    }
+    if (mobd > 255) return 255;
+    return (unsigned char)mobd;
+}
@@ -0,0 +1,54 @@
+/*********************************************************************************************/
+/* dsp.h - per-sample processing of BME363 functions 8 and 9 (4-7 are filter.c sets)         */
+/* Each kernel takes the new 8-bit A/D sample and returns the 8-bit D/A output. They share   */
+/* the sample history data0 (newest), data1 the way the cases of isr() always did, so        */
+/* switching functions behaves as before. No SFR access: the firmware and the replay tool    */
+/* run the same code.                                                                        */
+/*                                                                                           */
+/* mobd is a short: 16 bits on XC8 and on the host, so the products wrap like the PIC's.     */
+/*                                                                                           */
+/* MOBD threshold: with mobd_fixed = 0 it adapts, the way pantompkins.c does, to an eighth   */
+/* of the way from the noise peak level (mobd bumps that stay below it) to the signal peak   */
+/* level (mobd maxima of detected QRS), both running averages over 8 peaks, never below      */
+/* MOBD_FLOOR. An eighth, not Pan-Tompkins' quarter: mobd is the cube of the slope, so QRS   */
+/* heights spread over 8:1 with the sampling phase alone. After RR_MAX samples without a     */
+/* beat the signal level is halved. With mobd_fixed > 0 the threshold is that constant;      */
+/* DspMOBDThreshold() raises a fixed value below MOBD_FLOOR, negative too, to the floor.     */
+/*                                                                                           */
+/* RR history: each detection classifies the interval since the previous one (rr_status).   */
+/* Intervals within -25% / +50% of the history mean go into rr_hist, newest first, and       */
+/* mobd_hr is 60 s over that mean. The first beat after DspMOBDInit() and any beat after     */
+/* more than RR_MAX samples have no interval; RR_RESTART follows 4 outliers in a row, i.e.  */
+/* the rhythm really changed. Times are in samples: 5 ms at the 200 Hz of function 9.        */
+/* Update history: 10/17/2026 initiated                                                      */
+/*********************************************************************************************/
+#ifndef DSP_H
+#define DSP_H
+
+#define MOBD_REFRACTORY 40          // 200 ms without detections after a QRS
+#define MOBD_FLOOR      16          // Lowest adaptive threshold
+#define RR_HIST         8           // RR intervals kept for the heart rate
+#define RR_MAX          400         // 2 s, 30 bpm: longer means beats were missed
+
+#define RR_NONE         0           // rr_status: no interval (first beat, or after a gap)
+#define RR_OK           1           // interval added to the history
+#define RR_OUTLIER      2           // interval rejected, history unchanged
+#define RR_RESTART      3           // history restarted from this interval
+
+unsigned char DspMedian(unsigned char x);       // Function 8: see median.h
+unsigned char DspMOBD(unsigned char x);         // Function 9: MOBD QRS detector, 255-clipped
+void DspMOBDInit();                             // Forget the detector state and RR history
+void DspMOBDThreshold(int fixed);               // Fixed threshold from now on, 0 for adaptive
+
+extern unsigned char data0, data1;              // Last two input samples
+extern short mobd;                              // Last MOBD product
+extern int threshold;                           // MOBD detection threshold in use
+extern int mobd_fixed;                          // See DspMOBDThreshold()
+extern int mobd_spk, mobd_npk;                  // Signal and noise peak levels
+extern int rri_count;                           // Samples since the last detection
+extern unsigned char refractory;                // 1..39 after a MOBD detection, else 0
+extern int rr_hist[RR_HIST];                    // Accepted RR intervals, newest first
+extern unsigned char rr_n, rr_status;           // Entries in rr_hist, class of the last beat
+extern unsigned char mobd_hr;                   // Mean heart rate of rr_hist in bpm, 0 if none
+
+#endif
@@ -0,0 +1,178 @@
+/*********************************************************************************************/
+/* ecgsynth.c - ECG simulator of function 1, see ecgsynth.h                                  */
+/* The templates were drawn from raised-cosine P and T waves and a piecewise-linear QRS,     */
+/* R wave 160 LSB above a baseline of 64. A step costs one table read and a few compares,    */
+/* and only every other tick takes one: the rest hold the last value.                        */
+/* Update history: 10/17/2026 initiated                                                      */
+/*********************************************************************************************/
+#include "hal.h"
+#include "ecgsynth.h"
+
+static const unsigned char ecg_normal[ECG_LEN] = {
+     64,  64,  64,  64,  64,  65,  65,  66,  67,  67,  68,  70,  71,  72,  73,  75,
+     76,  77,  78,  79,  80,  81,  81,  82,  82,  82,  82,  82,  81,  81,  80,  79,
+     78,  77,  76,  75,  73,  72,  71,  70,  68,  67,  67,  66,  65,  65,  64,  64,
+     64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,
+     64,  64,  64,  64,  64,  64,  64,  62,  60,  58,  56,  54,  75,  96, 118, 139,
+    160, 182, 203, 224, 200, 176, 153, 129, 105,  82,  58,  34,  39,  44,  49,  54,
+     59,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,
+     64,  64,  64,  64,  65,  65,  66,  66,  67,  68,  69,  70,  71,  72,  74,  75,
+     76,  78,  79,  81,  82,  83,  85,  86,  88,  89,  90,  91,  92,  93,  94,  95,
+     96,  97,  97,  97,  98,  98,  98,  98,  98,  97,  97,  97,  96,  95,  94,  93,
+     92,  91,  90,  89,  88,  86,  85,  83,  82,  81,  79,  78,  76,  75,  74,  72,
+     71,  70,  69,  68,  67,  66,  66,  65,  65,  64,  64,  64,  64,  64,
+};
+static const unsigned char ecg_wide[ECG_LEN] = {
+     64,  64,  64,  64,  64,  65,  65,  66,  67,  67,  68,  70,  71,  72,  73,  75,
+     76,  77,  78,  79,  80,  81,  81,  82,  82,  82,  82,  82,  81,  81,  80,  79,
+     78,  77,  76,  75,  73,  72,  71,  70,  68,  67,  67,  66,  65,  65,  64,  64,
+     64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,
+     64,  64,  64,  64,  64,  64,  64,  62,  61,  59,  58,  56,  67,  77,  88,  99,
+    110, 120, 131, 142, 153, 163, 174, 167, 161, 154, 147, 141, 134, 139, 144, 149,
+    154, 159, 164, 169, 174, 179, 184, 174, 164, 154, 144, 134, 124, 114, 104,  94,
+     84,  74,  64,  54,  44,  46,  48,  51,  53,  55,  57,  60,  62,  64,  64,  64,
+     64,  63,  63,  63,  62,  62,  61,  61,  60,  59,  59,  58,  57,  56,  55,  55,
+     54,  53,  52,  51,  51,  50,  49,  49,  48,  48,  47,  47,  47,  46,  46,  46,
+     46,  46,  46,  46,  47,  47,  47,  48,  48,  49,  49,  50,  51,  51,  52,  53,
+     54,  55,  55,  56,  57,  58,  59,  59,  60,  61,  61,  62,  62,  63,
+};
+static const unsigned char ecg_invt[ECG_LEN] = {
+     64,  64,  64,  64,  64,  65,  65,  66,  67,  67,  68,  70,  71,  72,  73,  75,
+     76,  77,  78,  79,  80,  81,  81,  82,  82,  82,  82,  82,  81,  81,  80,  79,
+     78,  77,  76,  75,  73,  72,  71,  70,  68,  67,  67,  66,  65,  65,  64,  64,
+     64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,
+     64,  64,  64,  64,  64,  64,  64,  62,  60,  58,  56,  54,  75,  96, 118, 139,
+    160, 182, 203, 224, 200, 176, 153, 129, 105,  82,  58,  34,  38,  42,  46,  50,
+     54,  58,  58,  58,  58,  58,  58,  58,  58,  58,  58,  58,  58,  58,  58,  58,
+     58,  58,  58,  58,  58,  58,  58,  58,  58,  57,  57,  56,  56,  55,  54,  54,
+     54,  53,  52,  52,  51,  50,  50,  49,  47,  46,  45,  43,  42,  40,  39,  38,
+     37,  36,  35,  34,  33,  32,  31,  31,  31,  30,  30,  30,  30,  30,  31,  31,
+     31,  32,  33,  34,  35,  36,  37,  38,  39,  40,  42,  43,  45,  46,  47,  49,
+     50,  52,  53,  54,  56,  57,  58,  59,  60,  61,  62,  62,  63,  63,
+};
+static const unsigned char ecg_pvc[ECG_LEN] = {
+     64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,
+     64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,
+     64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,
+     64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  74,  84,  94,
+    104, 114, 124, 134, 144, 154, 164, 174, 184, 194, 204, 214, 208, 201, 195, 189,
+    183, 176, 170, 164, 157, 151, 145, 139, 132, 126, 120, 113, 107, 101,  96,  90,
+     84,  78,  73,  67,  62,  56,  50,  44,  39,  33,  28,  22,  20,  21,  22,  23,
+     24,  26,  27,  28,  29,  30,  32,  33,  34,  37,  40,  43,  46,  49,  52,  55,
+     58,  61,  63,  63,  62,  62,  61,  59,  58,  57,  55,  54,  52,  51,  49,  47,
+     46,  44,  42,  40,  39,  37,  36,  34,  33,  32,  31,  30,  29,  29,  28,  28,
+     28,  28,  28,  29,  29,  30,  31,  32,  33,  34,  36,  37,  39,  40,  42,  44,
+     46,  47,  49,  51,  52,  54,  55,  57,  58,  59,  61,  62,  62,  63,
+};
+
+static const unsigned char * const ecg_tpl[ECG_MORPHS] = { ecg_normal, ecg_wide, ecg_invt };
+static const unsigned char ecg_r_at[ECG_MORPHS] = { 83, 102, 83 };  // Step of the R peak
+#define ECG_PVC_R       75
+
+static const unsigned int ecg_rr_steps[32] = {    // RR interval at 30 + 4 i bpm, 2 ms steps
+    1000,  882,  789,  714,  652,  600,  555,  517,  483,  454,  428,  405,  384,  365,  348,  333,
+     319,  306,  294,  283,  272,  263,  254,  245,  238,  230,  223,  217,  211,  205,  200,  194,
+};
+
+static const signed char ecg_sine[64] = {         // Baseline wander
+      0,   1,   2,   3,   4,   5,   6,   6,   7,   8,   8,   9,   9,  10,  10,  10,
+     10,  10,  10,  10,   9,   9,   8,   8,   7,   6,   6,   5,   4,   3,   2,   1,
+      0,  -1,  -2,  -3,  -4,  -5,  -6,  -6,  -7,  -8,  -8,  -9,  -9, -10, -10, -10,
+    -10, -10, -10, -10,  -9,  -9,  -8,  -8,  -7,  -6,  -6,  -5,  -4,  -3,  -2,  -1,
+};
+
+static const unsigned char *tpl;    // Template of the current beat
+static unsigned char lo, hi;        // Steps of the template played, baseline elsewhere
+static unsigned char r_at, kind;    // R peak step and ecg_beat code, kind 0 if not conducted
+static unsigned int t, rr;          // Steps since the beat started, steps until the next one
+static unsigned int since;          // Steps since the last R wave
+static unsigned int rr_set;         // RR interval from EcgRate(), steps
+static unsigned char nbeat;         // Beat number mod 6, for the 2- and 3-beat patterns
+static unsigned char hold, out, lfsr = 0xE1, wcount, wphase;
+
+unsigned char ecg_morph, ecg_rhythm, ecg_opts, ecg_bpm, ecg_beat;
+unsigned int ecg_rr;
+
+void EcgInit(){  /*************************************** Start a new beat on the next step ***/
+    if (!rr_set) EcgRate(80);       // 70 bpm
+    t = rr = since = 0;
+    nbeat = hold = ecg_beat = 0;
+    out = ECG_BASE;
+}
+
+void EcgRate(unsigned char pot){  /***************************** Nominal rate, from the pot ***/
+    pot >>= 3;
+    rr_set = ecg_rr_steps[pot];
+    ecg_bpm = 30 + (pot << 2);
+}
+
+static void EcgBeat(){  /************* Template, played part and length of the beat starting ***/
+    tpl = ecg_tpl[ecg_morph];
+    r_at = ecg_r_at[ecg_morph];
+    kind = ECG_BEAT_N;
+    lo = 0;
+    hi = ECG_LEN;
+    rr = rr_set;
+    if (++nbeat == 6) nbeat = 0;
+    switch (ecg_rhythm) {
+    case ECG_BIGEMINY:              // N-V pairs still average the set rate
+        if (nbeat & 1) rr = rr_set - (rr_set >> 2) - (rr_set >> 3);    // Coupling: 5/8 RR
+        else {
+            tpl = ecg_pvc;
+            r_at = ECG_PVC_R;
+            kind = ECG_BEAT_V;
+            rr = rr_set + (rr_set >> 2) + (rr_set >> 3);               // Compensatory pause
+        }
+        break;
+    case ECG_AFIB:                  // No P wave, RR from 3/4 to 5/4 of the set interval
+        lfsr = (lfsr >> 1) ^ (-(lfsr & 1) & 0xB8);
+        lo = ECG_P_END;
+        rr = rr_set - (rr_set >> 2) + (((rr_set >> 4) * (lfsr >> 1)) >> 4);
+        break;
+    case ECG_BLOCK:                 // Beats 2 and 5 of 6: P wave only
+        if (nbeat == 2 || nbeat == 5) {
+            hi = ECG_P_END;
+            kind = 0;
+        }
+        break;
+    }
+    hal_cost(60);                   // Cycle model: beat set-up, once per beat
+}
+
+unsigned char EcgStep(){  /************************************ Next sample of the ECG ******/
+    int x;
+    if (!(hold ^= 1)) {             // Odd ticks repeat the step
+        hal_cost(10);
+        return out;
+    }
+    if (t >= rr) {
+        t = 0;
+        EcgBeat();
+    }
+    x = (t >= lo && t < hi) ? tpl[t] : ECG_BASE;
+    if (t == r_at && kind) {        // R wave: report it
+        ecg_beat = kind;
+        ecg_rr = since << 1;
+        since = 0;
+    }
+    t++;
+    since++;
+    hal_cost(40);                   // Cycle model: table read, compares, counters
+    if (ecg_opts & ECG_NOISE) {
+        lfsr = (lfsr >> 1) ^ (-(lfsr & 1) & 0xB8);
+        x += (lfsr & 15) - 8;
+        hal_cost(12);
+    }
+    if (ecg_opts & ECG_WANDER) {
+        if (++wcount == 31) {       // 64 x 31 x 2 ms = 4 s
+            wcount = 0;
+            wphase = (wphase + 1) & 63;
+        }
+        x += ecg_sine[wphase];
+        hal_cost(14);
+    }
+    if (x < 0) x = 0;
+    if (x > 255) x = 255;
+    out = (unsigned char)x;
+    return out;
+}
@@ -0,0 +1,44 @@
+/*********************************************************************************************/
+/* ecgsynth.h - ECG simulator of function 1: beat templates played at 1 kHz                  */
+/* Each beat plays one 380 ms P-QRS-T template from program memory (2 ms steps) and then     */
+/* holds the baseline until the RR interval set by EcgRate() is over: 30 to 154 bpm from     */
+/* the potentiometer. The morphology, rhythm and options take effect from the next beat.     */
+/* Rhythms: sinus; bigeminy (every other beat a PVC at 62% of the RR interval, then a        */
+/* compensatory pause); atrial fibrillation (no P wave, RR random within +-25%); 3:2 AV      */
+/* block (every third P wave not conducted).                                                 */
+/* Update history: 10/17/2026 initiated                                                      */
+/*********************************************************************************************/
+#ifndef ECGSYNTH_H
+#define ECGSYNTH_H
+
+#define ECG_LEN         190         // Template length, 2 ms steps
+#define ECG_P_END       60          // P wave over, QRS not yet begun
+#define ECG_BASE        64          // Isoelectric level
+
+#define ECG_NORMAL      0           // ecg_morph: normal sinus beat
+#define ECG_WIDE        1           // Wide notched QRS, discordant T (bundle branch block)
+#define ECG_INVT        2           // Depressed ST, inverted T (ischemia)
+#define ECG_MORPHS      3
+
+#define ECG_SINUS       0           // ecg_rhythm
+#define ECG_BIGEMINY    1
+#define ECG_AFIB        2
+#define ECG_BLOCK       3
+#define ECG_RHYTHMS     4
+
+#define ECG_NOISE       0x01        // ecg_opts: +-8 LSB white noise
+#define ECG_WANDER      0x02        // +-10 LSB baseline wander, 4 s period (respiration)
+
+#define ECG_BEAT_N      1           // ecg_beat: conducted beat
+#define ECG_BEAT_V      2           // Premature ventricular contraction
+
+void EcgInit();                     // Start over with a new beat on the next call
+void EcgRate(unsigned char pot);    // 0-255 -> 30-154 bpm in steps of 4
+unsigned char EcgStep();            // Next 1 kHz sample
+
+extern unsigned char ecg_morph, ecg_rhythm, ecg_opts;
+extern unsigned char ecg_bpm;       // Rate set by EcgRate()
+extern unsigned char ecg_beat;      // ECG_BEAT_x at each R wave, cleared by the caller
+extern unsigned int ecg_rr;         // ms since the previous R wave (or EcgInit())
+
+#endif
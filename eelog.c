@@ -0,0 +1,145 @@
+/*********************************************************************************************/
+/* eelog.c - log-structured EEPROM store with wear leveling, see eelog.h                     */
+/* EeInit() and the readers wait for a write in progress (up to 4 ms); EeLog() and           */
+/* EeService() never do. A byte that already holds the value to write is skipped: no wear,   */
+/* no 4 ms.                                                                                  */
+/* Update history: 10/17/2026 initiated                                                      */
+/*********************************************************************************************/
+#include "hal.h"
+#include "eelog.h"
+
+#define EE_MASK         (EE_SLOTS - 1)  // EE_SLOTS is a power of 2
+
+unsigned char ee_records, ee_bad, ee_drops;
+static unsigned char head, seq;             // Slot and seq of the next record
+static unsigned char key_slot[EE_KEYS];     // Newest record of each setting, EE_NONE if none
+static unsigned char rec[EE_SLOT], w_pos = EE_SLOT;  // Record being written, next byte
+static unsigned char buf[EE_SLOT];          // Record being read
+static unsigned char q_type[EE_QUEUE], q_data[EE_QUEUE][EE_DATA], q_first, q_n;
+
+static unsigned char Crc8(const unsigned char *p, unsigned char n){  /** x^8 + x^2 + x + 1 ***/
+    unsigned char crc = 0, b;
+    while (n--) {
+        crc ^= *p++;
+        for (b = 0; b < 8; b++) crc = crc & 0x80 ? (crc << 1) ^ 0x07 : crc << 1;
+    }
+    return crc;
+}
+
+unsigned char EeReadByte(unsigned int address){  /***************** One byte of the EEPROM ***/
+    while (hal_eeprom_busy()) hal_spin();   // Not while a write is in progress
+    hal_eeprom_fetch(address);
+    return hal_eeprom_data();
+}
+
+static unsigned char SlotRead(unsigned char slot, unsigned char *r){  /** 1 if CRC good **/
+    unsigned char i;
+    for (i = 0; i < EE_SLOT; i++) r[i] = EeReadByte((unsigned int)slot * EE_SLOT + i);
+    return r[1] != EE_NONE && Crc8(r, EE_SLOT - 1) == r[EE_SLOT - 1];
+}
+
+void EeInit(){  /******************************** Newest record and settings from the ring ***/
+    unsigned char i, s, ok, prev = 0, last = EE_NONE, sq = 0, last_sq = 0;
+    ee_records = ee_bad = 0;
+    for (i = 0; i <= EE_SLOTS; i++) {       // Slot 0 twice: the break can be at the wrap
+        s = i & EE_MASK;
+        ok = SlotRead(s, buf);
+        if (i < EE_SLOTS) {
+            if (ok) ee_records++;
+            else if (buf[1] != EE_NONE) ee_bad++;   // Cut short or corrupted, not erased
+        }
+        if (prev && last == EE_NONE && (!ok || buf[0] != (unsigned char)(sq + 1))) {
+            last = (i - 1) & EE_MASK;       // Newest: the next slot does not follow on
+            last_sq = sq;
+        }
+        prev = ok;
+        sq = buf[0];
+    }
+    head = last == EE_NONE ? 0 : (last + 1) & EE_MASK;
+    seq = last_sq + 1;
+    for (i = 0; i < EE_KEYS; i++) key_slot[i] = EE_NONE;
+    for (i = 0; i < EE_SLOTS; i++) {        // Oldest to newest: the last one of a key counts
+        s = (head + i) & EE_MASK;
+        if (SlotRead(s, buf) && buf[1] < EE_KEYS) key_slot[buf[1]] = s;
+    }
+    q_first = q_n = 0;
+    w_pos = EE_SLOT;
+}
+
+unsigned char EeLog(unsigned char type, const unsigned char *data, unsigned char len){  /* Queue */
+    unsigned char i, k;
+    k = q_first;
+    for (i = 0; i < q_n; i++) {             // A setting already queued: replace its data
+        if (type < EE_KEYS && q_type[k] == type) break;
+        k = (k + 1) % EE_QUEUE;
+    }
+    if (i == q_n) {
+        if (q_n == EE_QUEUE) {
+            ee_drops++;
+            return 0;
+        }
+        q_type[k] = type;
+        q_n++;
+    }
+    for (i = 0; i < EE_DATA; i++) q_data[k][i] = i < len ? data[i] : 0;
+    return 1;
+}
+
+void EeService(){  /************************* At most one byte write per call, never waits ***/
+    unsigned char i, k;
+    if (hal_eeprom_busy()) return;          // 4 ms per byte: come back later
+    if (w_pos == EE_SLOT) {                 // Idle: build the next record
+        if (!q_n) return;
+        for (k = 0; k < EE_KEYS; k++)       // A setting at the head or next: copy it
+            if (key_slot[k] == head || key_slot[k] == ((head + 1) & EE_MASK)) break;
+        if (k < EE_KEYS) SlotRead(key_slot[k], rec);
+        else {
+            rec[1] = q_type[q_first];
+            for (i = 0; i < EE_DATA; i++) rec[2 + i] = q_data[q_first][i];
+            q_first = (q_first + 1) % EE_QUEUE;
+            q_n--;
+        }
+        rec[0] = seq;
+        rec[EE_SLOT - 1] = Crc8(rec, EE_SLOT - 1);
+        w_pos = 0;
+    }
+    while (w_pos < EE_SLOT) {
+        hal_eeprom_fetch((unsigned int)head * EE_SLOT + w_pos);
+        if (hal_eeprom_data() != rec[w_pos]) {
+            hal_eeprom_write((unsigned int)head * EE_SLOT + w_pos, rec[w_pos]);
+            w_pos++;
+            break;
+        }
+        w_pos++;                            // Same value: skip it
+    }
+    if (w_pos == EE_SLOT) {                 // Last byte started: the record is in place
+        if (rec[1] < EE_KEYS) key_slot[rec[1]] = head;
+        head = (head + 1) & EE_MASK;
+        seq++;
+        if (ee_records < EE_SLOTS) ee_records++;
+    }
+}
+
+unsigned char EeSetting(unsigned char key, unsigned char *data){  /****** EE_DATA bytes ******/
+    unsigned char i, k;
+    k = q_first;
+    for (i = 0; i < q_n; i++) {             // Queued: newer than the EEPROM
+        if (q_type[k] == key) {
+            for (i = 0; i < EE_DATA; i++) data[i] = q_data[k][i];
+            return 1;
+        }
+        k = (k + 1) % EE_QUEUE;
+    }
+    if (key_slot[key] == EE_NONE || !SlotRead(key_slot[key], buf)) return 0;
+    for (i = 0; i < EE_DATA; i++) data[i] = buf[2 + i];
+    return 1;
+}
+
+unsigned char EeRecord(unsigned char back, unsigned char *r){  /******** EE_SLOT bytes *******/
+    if (back >= ee_records) return 0;
+    return SlotRead((head - 1 - back) & EE_MASK, r);
+}
+
+unsigned char EeIdle(){  /************************************ Safe to power down or sleep ***/
+    return !q_n && w_pos == EE_SLOT && !hal_eeprom_busy();
+}
@@ -0,0 +1,54 @@
+/*********************************************************************************************/
+/* eelog.h - log-structured store in the 1 KB data EEPROM: settings and events               */
+/* The EEPROM is a ring of EE_SLOTS records of EE_SLOT bytes, written one after the other:   */
+/*                                                                                           */
+/*     seq type data0 ... data12 crc                                                         */
+/*                                                                                           */
+/* seq   +1 per record written (8 bits), so the newest record is the one before the break    */
+/* type  EE_KEY_* for a setting, EE_EV_* for an event, 0xFF for an erased slot               */
+/* crc   CRC-8 (x^8 + x^2 + x + 1) of seq..data12: a record cut short by a reset is ignored  */
+/*                                                                                           */
+/* Wear leveling: every record goes to the next slot, so each cell is written once per turn  */
+/* of the ring however often one value changes: 1 M cycles x 64 slots at one record a        */
+/* minute is over a century. A setting is its newest record of that type; when the ring      */
+/* comes round to it, it is written again at the head first, so settings outlive any number  */
+/* of events.                                                                                */
+/*                                                                                           */
+/* Batched writes: EeLog() only queues the record in RAM and EeService(), called from the    */
+/* main loop, writes one byte whenever the EEPROM is not busy (4 ms per byte), never waiting */
+/* on WR. A setting queued again before its turn replaces the queued copy, so a burst of     */
+/* changes costs one record.                                                                 */
+/* Update history: 10/17/2026 initiated                                                      */
+/*********************************************************************************************/
+#ifndef EELOG_H
+#define EELOG_H
+
+#define EE_SIZE         1024        // PIC18F4525 data EEPROM
+#define EE_SLOT         16          // Bytes per record
+#define EE_SLOTS        (EE_SIZE / EE_SLOT)
+#define EE_DATA         13          // Data bytes per record, unused ones are 0
+#define EE_QUEUE        4           // Records waiting in RAM
+#define EE_NONE         0xFF        // Type of an erased or bad slot, and of no record
+
+#define EE_KEYS         8           // Setting types 0..EE_KEYS-1
+#define EE_KEY_HELIO    0           // Heliostat: day (2), hour, minute, pan (2), tilt (2),
+                                    // pan offset (2), tilt offset (2), percent asleep
+#define EE_KEY_BME      1           // BME363: median window, ECG shape, rhythm, options,
+                                    // MOBD threshold (2, 0 for adaptive)
+#define EE_EV_HR        0x10        // Heart rate: function, beats (2), mean, min, max bpm
+#define EE_EV_FAULT     0x11        // Fault counters, as in the CMD_STATS reply
+#define EE_EV_BOOT      0x12        // Power-up: bad records found by EeInit()
+
+void EeInit();                      // Find the head and the settings, call once at power-up
+unsigned char EeLog(unsigned char type, const unsigned char *data, unsigned char len);
+void EeService();                   // Write the queue in the background, call from main()
+unsigned char EeSetting(unsigned char key, unsigned char *data);   // Newest, 0 if none
+unsigned char EeRecord(unsigned char back, unsigned char *rec);    // Whole slot, 0 = newest
+unsigned char EeIdle();             // Nothing queued or being written
+unsigned char EeReadByte(unsigned int address);
+
+extern unsigned char ee_records;    // Valid records found by EeInit(), up to EE_SLOTS
+extern unsigned char ee_bad;        // Slots with a CRC error found by EeInit()
+extern unsigned char ee_drops;      // EeLog() calls with the queue full
+
+#endif
@@ -0,0 +1,116 @@
+/*********************************************************************************************/
+/* filter.c - fixed-point FIR / biquad filter engine, see filter.h                           */
+/* Sets 0-3 are the original three-tap filters of functions 4-7; 0, 1 and 3 give the same    */
+/* output as before, 2 rounds down where it used to round up. The biquads follow the RBJ     */
+/* audio EQ cookbook, the FIR low-pass is a Hamming-windowed sinc.                           */
+/* Update history: 10/17/2026 initiated                                                      */
+/*********************************************************************************************/
+#include "hal.h"
+#include "filter.h"
+
+static const signed char fir_derivative[] = { 1, -1 };             // x(n) - x(n-1)
+static const signed char fir_lowpass[] = { 1, 2, 1 };              // / 4
+static const signed char fir_hifreq[] = { 7, -2, -1 };             // 2 x(n) - low-pass
+static const signed char fir_notch[] = { 1, 0, 1 };                // / 2, zero at fs/4 = 60 Hz
+static const signed char fir_lp30[] = {                            // 30 Hz, Q7
+    0, -1, -1, 0, 6, 17, 28, 30, 28, 17, 6, 0, -1, -1, 0 };
+static const int sos_notch60[] = {                                 // Q = 6: -3 dB at 55-65 Hz
+    15124, 0, 15124, 0, 13863 };
+static const int sos_notch50[] = {
+    15163, -7849, 15163, -7849, 13943 };
+static const int sos_qrs[] = {                                     // Butterworth HP 5 + LP 15
+    14935, -29871, 14935, -29743, 13615,
+    491, 982, 491, -23826, 9405 };
+static const int sos_ecg[] = {                                     // Butterworth HP 0.5 + LP 40
+    16233, -32466, 16233, -32465, 16083,
+    2540, 5081, 2540, -10161, 3939 };
+
+const struct filter filter_sets[FILTER_SETS] = {
+    { "Derivative      ", FILTER_FIR,    2,  0, fir_derivative, 0 },
+    { "Low-pass filter ", FILTER_FIR,    3,  2, fir_lowpass,    0 },
+    { "Hi-freq enhance ", FILTER_FIR,    3,  2, fir_hifreq,     0 },
+    { "60Hz notch filtr", FILTER_FIR,    3,  1, fir_notch,      0 },
+    { "60Hz notch IIR  ", FILTER_BIQUAD, 1,  0, 0,              sos_notch60 },
+    { "50Hz notch IIR  ", FILTER_BIQUAD, 1,  0, 0,              sos_notch50 },
+    { "QRS band 5-15Hz ", FILTER_BIQUAD, 2,  0, 0,              sos_qrs },
+    { "ECG band .5-40Hz", FILTER_BIQUAD, 2,  0, 0,              sos_ecg },
+    { "FIR 15-tap 30Hz ", FILTER_FIR,    15, 7, fir_lp30,       0 },
+};
+
+static signed char user_fir[FILTER_TAPS] = { 1 };
+static int user_sos[5 * FILTER_SECTIONS];
+static struct filter filter_user = { "User filter     ", FILTER_FIR, 1, 0, user_fir, user_sos };
+
+unsigned char filter_set;
+static const struct filter *cur = &filter_sets[0];
+static signed char fir_dl[FILTER_TAPS];             // x(n) - 128, newest at fir_k
+static unsigned char fir_k;
+static int bq_dl[2 * FILTER_SECTIONS + 2];          // x(n-1), x(n-2), then y(n-1), y(n-2) of
+                                                    // each section (the next one's input)
+void FilterSelect(unsigned char set){  /********************* Switch set, clear the history ***/
+    unsigned char i;
+    filter_set = set;
+    cur = FilterGet(set);
+    for (i = 0; i < FILTER_TAPS; i++) fir_dl[i] = 0;
+    for (i = 0; i < 2 * FILTER_SECTIONS + 2; i++) bq_dl[i] = 0;
+}
+
+unsigned char FilterStep(unsigned char x){  /************************** Filter one sample ******/
+    long acc;
+    int v, *s;
+    const int *c;
+    unsigned char i;
+    if (cur->type == FILTER_FIR) {
+        fir_k = (fir_k + 1) & (FILTER_TAPS - 1);
+        fir_dl[fir_k] = x - 128;
+        acc = 0;
+        for (i = 0; i < cur->n; i++)        // 8 x 8 hardware multiply per tap
+            acc += cur->fir[i] * fir_dl[(fir_k - i) & (FILTER_TAPS - 1)];
+        acc >>= cur->shift;
+        hal_cost(20 + 14 * cur->n);         // Cycle model: MULWF and a 24-bit add per tap
+    }
+    else {
+        v = (x - 128) << FILTER_GUARD;
+        for (i = 0, s = bq_dl, c = cur->sos; i < cur->n; i++, s += 2, c += 5) {
+            acc = (long)c[0] * v + (long)c[1] * s[0] + (long)c[2] * s[1]
+                - (long)c[3] * s[2] - (long)c[4] * s[3];
+            s[1] = s[0];
+            s[0] = v;
+            v = (int)((acc + (1L << 13)) >> 14);
+        }
+        s[1] = s[0];                        // Output history of the last section
+        s[0] = v;
+        acc = (v + (1 << (FILTER_GUARD - 1))) >> FILTER_GUARD;
+        hal_cost(30 + 5 * 40 * cur->n);     // Cycle model: five 16 x 16 multiplies per section
+    }
+    acc += 128;
+    if (acc < 0) return 0;
+    if (acc > 255) return 255;
+    return (unsigned char)acc;
+}
+
+const struct filter *FilterGet(unsigned char set){  /********** Table entry or the RAM set ******/
+    if (set < FILTER_SETS) return &filter_sets[set];
+    return &filter_user;
+}
+
+unsigned char FilterLoad(unsigned char type, const unsigned char *data, unsigned char len){
+    unsigned char i;                /************************ New coefficients for FILTER_USER ***/
+    if (type == FILTER_FIR) {
+        if (len < 2 || len > FILTER_TAPS + 1 || data[0] > 7) return 0;
+        filter_user.shift = data[0];
+        filter_user.n = len - 1;
+        for (i = 0; i < filter_user.n; i++) user_fir[i] = (signed char)data[i + 1];
+    }
+    else if (type == FILTER_BIQUAD) {
+        if (!len || len % 10 || len > 10 * FILTER_SECTIONS) return 0;
+        filter_user.shift = 0;
+        filter_user.n = len / 10;
+        for (i = 0; i < len / 2; i++)       // short: sign of the 16-bit value on the host too
+            user_sos[i] = (short)(data[2 * i] | data[2 * i + 1] << 8);
+    }
+    else return 0;
+    filter_user.type = type;
+    if (filter_set == FILTER_USER) FilterSelect(FILTER_USER);  // Old history means nothing now
+    return 1;
+}
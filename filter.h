@@ -0,0 +1,52 @@
+/*********************************************************************************************/
+/* filter.h - fixed-point FIR / biquad filter engine of functions 4-7                        */
+/* A filter is a coefficient set from filter_sets[], either                                  */
+/*   FIR:    y(n) = sum h(i) x(n-i) / 2^shift, h in Q(shift) as signed char (Q7 at most),    */
+/*           up to FILTER_TAPS taps on a circular delay line, or                             */
+/*   biquad: a cascade of up to FILTER_SECTIONS direct-form I sections,                      */
+/*           y = b0 x(n) + b1 x(n-1) + b2 x(n-2) - a1 y(n-1) - a2 y(n-2), Q14 (|c| < 2).     */
+/* Samples are centred on 128 before filtering and the output is centred on 128 again, so   */
+/* a derivative or band-pass sits mid-scale. Biquads carry FILTER_GUARD extra bits inside.   */
+/* All sets are designed for the 240 Hz rate of functions 4-7.                               */
+/* Set FILTER_USER, just past the table, lives in RAM and is loaded at run time with         */
+/* FilterLoad(), from the coefficient bytes of a Bluetooth command (see command.h).          */
+/* Update history: 10/17/2026 initiated                                                      */
+/*********************************************************************************************/
+#ifndef FILTER_H
+#define FILTER_H
+
+#define FILTER_TAPS     32          // Delay line, power of 2
+#define FILTER_SECTIONS 4
+#define FILTER_GUARD    5           // Fraction bits of the biquad states
+
+#define FILTER_FIR      0
+#define FILTER_BIQUAD   1
+
+struct filter {
+    const char *name;               // LCD line 2, 16 characters
+    unsigned char type;             // FILTER_FIR or FILTER_BIQUAD
+    unsigned char n;                // Taps or sections
+    unsigned char shift;            // FIR: coefficients are Q(shift)
+    const signed char *fir;         // FIR: h(0) .. h(n-1)
+    const int *sos;                 // Biquad: b0 b1 b2 a1 a2 per section
+};
+
+#define FILTER_DERIVATIVE   0       // Functions 4-7 start with sets 0-3
+#define FILTER_LOWPASS      1
+#define FILTER_HIFREQ       2
+#define FILTER_NOTCH        3
+#define FILTER_SETS         9
+#define FILTER_USER         FILTER_SETS     // Loaded by FilterLoad(), a pass-through until then
+
+extern const struct filter filter_sets[FILTER_SETS];
+extern unsigned char filter_set;    // Set FilterStep() runs
+
+void FilterSelect(unsigned char set);   // Switch to a set and clear the delay line
+unsigned char FilterStep(unsigned char x);
+const struct filter *FilterGet(unsigned char set);     // filter_sets[set] or the user set
+unsigned char FilterLoad(unsigned char type, const unsigned char *data, unsigned char len);
+                                    // FIR: shift h(0) .. h(n-1), n = len - 1 (signed bytes)
+                                    // Biquad: b0 b1 b2 a1 a2 per section, 16-bit little endian
+                                    // Returns 0 (set unchanged) if len does not fit the type
+
+#endif
@@ -0,0 +1,55 @@
+/*********************************************************************************************/
+/* fmt.c - decimal formatting by subtraction of powers of ten, see fmt.h                     */
+/* A 16-bit value takes at most 5 x 9 subtractions, fewer than one library division.         */
+/* Update history: 10/17/2026 initiated                                                      */
+/*********************************************************************************************/
+#include "hal.h"
+#include "fmt.h"
+
+static const unsigned long power[10] = {
+    1000000000UL, 100000000UL, 10000000UL, 1000000UL, 100000UL, 10000UL, 1000UL, 100UL, 10UL,
+    1UL };
+
+static unsigned char Digits(unsigned char *buf, unsigned long v, unsigned char min){
+    unsigned char i, n = 0, d;
+    for (i = 0; i < 10; i++) {
+        d = '0';
+        while (v >= power[i]) {     // At most 9 times
+            v -= power[i];
+            d++;
+        }
+        if (n || d != '0' || i >= 10 - min || i == 9) buf[n++] = d;
+    }
+    return n;
+}
+
+unsigned char FmtNum(unsigned char *buf, long value, unsigned char width, unsigned int flags){
+    unsigned char digits[10], n, sign = 0, len, i, o = 0;
+    unsigned long v;
+    if (!(flags & FMT_UNSIGNED) && value < 0) {
+        sign = '-';
+        v = -(unsigned long)value;
+    }
+    else {
+        v = value;
+        if (flags & FMT_PLUS) sign = '+';
+    }
+    n = Digits(digits, v, flags & 0x0F);
+    len = n + (sign != 0);
+    if (width && len > width) {     // Too long for the field
+        if (!(flags & FMT_CLAMP) || width < 1 + (sign != 0)) {
+            for (i = 0; i < width; i++) buf[i] = '#';
+            return width;
+        }
+        n = width - (sign != 0);    // All nines
+        for (i = 0; i < n; i++) digits[i] = '9';
+        len = width;
+    }
+    if (!width) width = len;
+    if (!(flags & (FMT_LEFT | FMT_ZERO))) while (o < width - len) buf[o++] = ' ';
+    if (sign) buf[o++] = sign;
+    if (flags & FMT_ZERO && !(flags & FMT_LEFT)) while (o < width - n) buf[o++] = '0';
+    for (i = 0; i < n; i++) buf[o++] = digits[i];
+    while (o < width) buf[o++] = ' ';   // FMT_LEFT
+    return o;
+}
@@ -0,0 +1,28 @@
+/*********************************************************************************************/
+/* fmt.h - decimal formatting without division, for the LCD and the serial reports          */
+/* FmtNum() writes value into buf as ASCII, no terminating 0, and returns the length. The    */
+/* digits come from subtracting powers of ten: the PIC18 has no divider, and the / 10 and    */
+/* % 10 of the old Print* routines each called the 16- or 32-bit library division.           */
+/*                                                                                           */
+/*   width   0: as long as the number; else the field length, right-aligned unless FMT_LEFT  */
+/*   flags   FMT_DIGITS(n) at least n digits (leading zeros), FMT_ZERO pad with zeros after  */
+/*           the sign, FMT_PLUS + before positive numbers, FMT_LEFT pad on the right,        */
+/*           FMT_UNSIGNED value is an unsigned long, FMT_CLAMP a number too long for width   */
+/*           becomes the largest one that fits (999, -99); without it the field is all '#'   */
+/* Update history: 10/17/2026 initiated                                                      */
+/*********************************************************************************************/
+#ifndef FMT_H
+#define FMT_H
+
+#define FMT_MAX         11          // Longest output with width 0: sign and 10 digits
+
+#define FMT_DIGITS(n)   (n)         // Minimum digits, 0-10, in the low 4 bits
+#define FMT_ZERO        0x10
+#define FMT_PLUS        0x20
+#define FMT_LEFT        0x40
+#define FMT_CLAMP       0x80
+#define FMT_UNSIGNED    0x100
+
+unsigned char FmtNum(unsigned char *buf, long value, unsigned char width, unsigned int flags);
+
+#endif
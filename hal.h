@@ -0,0 +1,44 @@
+/*********************************************************************************************/
+/* hal.h - thin hardware abstraction for the PIC18F4525 firmwares                            */
+/* All SFR accesses in the firmwares go through these calls. Built with XC8 they are the     */
+/* register macros of hal_pic18.h and compile to the same code as before; built with         */
+/* -DHOST_SIM they drive the virtual PIC in hal_sim.c, so both firmwares run on Linux.       */
+/*                                                                                           */
+/* ADC     hal_adc_init()  hal_adc_select(ch)  hal_adc_start()  hal_adc_done()               */
+/*         hal_adc_result()                                                                  */
+/* DAC     hal_dac_write(value)                          8-bit R-2R ladder on PORTD          */
+/* Timer   hal_tmr0_start(ps)  hal_tmr0_reload(h, l)  hal_tmr0_pending()  hal_tmr0_ack()     */
+/*         hal_tmr0_irq(on)             TMR0: ps = PSA:T0PS, 0x08 = 1 count per cycle (rate.h) */
+/*         hal_tmr2_start(t2con, pr2)  hal_tmr2_pending()  hal_tmr2_ack()                    */
+/*         hal_tmr2_irq(on)  hal_tmr2_irq_on()                                               */
+/*         hal_tmr1_start()  hal_tmr1_read()             TMR1: free-running, 1 count per us  */
+/*         hal_tmr3_start(ps)  hal_tmr3_read()  hal_tmr3_pending()  hal_tmr3_ack()           */
+/*         hal_tmr3_irq(on)                 TMR3: free-running, ps = T3CKPS (timebase.h)     */
+/* UART    hal_uart_init(spbrg)  hal_uart_baud(spbrg)  hal_uart_tx_ready()  hal_uart_put(c)  */
+/*         hal_uart_tx_irq(on)  hal_uart_tx_irq_on()  hal_uart_rx_ready()  hal_uart_get()    */
+/*         hal_uart_rx_irq(on)  hal_uart_rx_overrun()  hal_uart_rx_restart()                 */
+/* GPIO    hal_port_dir(port, tris)  hal_port_write(port, value)  hal_pin_read(port, bit)    */
+/*         hal_pin_write(port, bit, value)  hal_pin_toggle(port, bit)   port = A..E          */
+/* IRQ     hal_irq_enable()  hal_irq_disable()  hal_irq_peripherals()                        */
+/*         hal_int_pending(n)  hal_int_ack(n)  hal_int_irq(n, on)  hal_int_edge(n, rising)   */
+/*                                                               n = 0..2 for INT0..INT2     */
+/* EEPROM  hal_eeprom_busy()  hal_eeprom_write(address, data)  hal_eeprom_fetch(address)     */
+/*         hal_eeprom_data()                              address = 0..1023 (EEADRH:EEADR) */
+/* Misc    hal_spin()        body of busy-wait loops: no code on the PIC, advances the       */
+/*                           virtual clock on the host                                       */
+/*         hal_cost(n)       n cycles of straight-line C: no code on the PIC, charged to the   */
+/*                           virtual clock (cycle model of the hot loops)                    */
+/*         hal_idle()        IDLE mode until an enabled interrupt flag is set, GIE or not:   */
+/*                           the CPU stops, the oscillator, timers and USART keep running    */
+/* Update history: 10/17/2026 initiated                                                      */
+/*********************************************************************************************/
+#ifndef HAL_H
+#define HAL_H
+
+#ifdef HOST_SIM
+#include "hal_sim.h"
+#else
+#include "hal_pic18.h"
+#endif
+
+#endif
@@ -0,0 +1,112 @@
+/*********************************************************************************************/
+/* hal_pic18.h - PIC18F4525 backend of hal.h: register macros, no code of its own            */
+/* Update history: 10/17/2026 initiated                                                      */
+/*********************************************************************************************/
+#ifndef HAL_PIC18_H
+#define HAL_PIC18_H
+
+#include <p18cxxx.h>
+
+#define hal_spin()
+#define hal_cost(n)
+#define hal_idle()      do { OSCCONbits.IDLEN = 1; SLEEP(); } while (0)    // Not SLEEP mode
+
+/****************************************** A/D *********************************************/
+#define hal_adc_init()      do { TRISA = 0b11111111;    /* Set all of Port A as input */      \
+                                 ADCON2 = 0b00001001;   /* acq time = 2 TAD; clock Fosc/8 */  \
+                                 ADCON1 = 0b00001010;   /* Vref = VSS/VDD; AN0-AN4 analog */  \
+                            } while (0)
+#define hal_adc_select(ch)  do { ADCON0 = ((ch) << 2) + 0b00000001; /* 5-2 channel; 0 on */   \
+                                 PIE1bits.ADIE = 0;     /* Turn off the AD interrupt */       \
+                                 PIR1bits.ADIF = 0;     /* Reset the AD interrupt flag */     \
+                            } while (0)
+#define hal_adc_start()     (ADCON0bits.GO = 1)
+#define hal_adc_done()      (PIR1bits.ADIF)
+#define hal_adc_result()    (ADRESH)                    // Highest 8 bits of the 10-bit result
+
+/****************************************** D/A *********************************************/
+#define hal_dac_write(value)    (PORTD = (value))
+
+/**************************************** Timers ********************************************/
+#define hal_tmr0_start(ps)      (T0CON = 0b10000000 | (ps)) // On, 16-bit, Fosc/4, PSA:T0PS
+#define hal_tmr0_reload(h, l)   do { TMR0H = (h); TMR0L = (l); } while (0)
+#define hal_tmr0_pending()      (INTCONbits.TMR0IF)
+#define hal_tmr0_ack()          (INTCONbits.TMR0IF = 0)
+#define hal_tmr0_irq(on)        (INTCONbits.TMR0IE = (on))
+#define hal_tmr2_start(t2con, pr2)  do { PR2 = (pr2); T2CON = (t2con); } while (0)
+#define hal_tmr2_pending()      (PIR1bits.TMR2IF)
+#define hal_tmr2_ack()          (PIR1bits.TMR2IF = 0)
+#define hal_tmr2_irq(on)        (PIE1bits.TMR2IE = (on))
+#define hal_tmr2_irq_on()       (PIE1bits.TMR2IE)
+#define hal_tmr1_start()        (T1CON = 0b10000001)    // On, 16-bit read, Fosc/4, 1:1
+#define hal_tmr1_read()         (TMR1)                  // XC8 reads TMR1L, then TMR1H
+#define hal_tmr3_start(ps)      (T3CON = 0b10000001 | (ps) << 4)    // On, 16-bit read, Fosc/4
+#define hal_tmr3_read()         (TMR3)
+#define hal_tmr3_pending()      (PIR2bits.TMR3IF)
+#define hal_tmr3_ack()          (PIR2bits.TMR3IF = 0)
+#define hal_tmr3_irq(on)        (PIE2bits.TMR3IE = (on))
+
+/***************************************** USART ********************************************/
+#define hal_uart_init(spbrg)    do { SPBRG = (spbrg);                                         \
+                                     TXSTAbits.TXEN = 1;    /* Transmit enable */             \
+                                     TXSTAbits.SYNC = 0;    /* Asynchronous mode */           \
+                                     RCSTAbits.CREN = 1;    /* Continuous receive */          \
+                                     RCSTAbits.SPEN = 1;    /* Serial Port Enable */          \
+                                     TXSTAbits.BRGH = 1;    /* High speed baud rate */        \
+                                } while (0)
+#define hal_uart_baud(spbrg)    (SPBRG = (spbrg))
+#define hal_uart_tx_ready()     (PIR1bits.TXIF)
+#define hal_uart_put(c)         (TXREG = (c))
+#define hal_uart_tx_irq(on)     (PIE1bits.TXIE = (on))
+#define hal_uart_tx_irq_on()    (PIE1bits.TXIE)
+#define hal_uart_rx_ready()     (PIR1bits.RCIF)
+#define hal_uart_get()          (RCREG)
+#define hal_uart_rx_irq(on)     (PIE1bits.RCIE = (on))
+#define hal_uart_rx_overrun()   (RCSTAbits.OERR)                // Cleared by toggling CREN
+#define hal_uart_rx_restart()   do { RCSTAbits.CREN = 0; RCSTAbits.CREN = 1; } while (0)
+
+/***************************************** GPIO *********************************************/
+#define hal_port_dir(port, tris)        (TRIS##port = (tris))
+#define hal_port_write(port, value)     (PORT##port = (value))
+#define hal_pin_read(port, bit)         (PORT##port##bits.R##port##bit)
+#define hal_pin_write(port, bit, value) (PORT##port##bits.R##port##bit = (value))
+#define hal_pin_toggle(port, bit)       (PORT##port##bits.R##port##bit = !PORT##port##bits.R##port##bit)
+
+/************************************** Interrupts ******************************************/
+#define hal_irq_enable()        (INTCONbits.GIE = 1)
+#define hal_irq_disable()       (INTCONbits.GIE = 0)
+#define hal_irq_peripherals()   (INTCONbits.PEIE = 1)
+#define HAL_INT0_IF             INTCONbits.INT0IF
+#define HAL_INT0_IE             INTCONbits.INT0IE
+#define HAL_INT1_IF             INTCON3bits.INT1IF
+#define HAL_INT1_IE             INTCON3bits.INT1IE
+#define HAL_INT2_IF             INTCON3bits.INT2IF
+#define HAL_INT2_IE             INTCON3bits.INT2IE
+#define hal_int_pending(n)      (HAL_INT##n##_IF)
+#define hal_int_ack(n)          (HAL_INT##n##_IF = 0)
+#define hal_int_irq(n, on)      (HAL_INT##n##_IE = (on))
+#define hal_int_edge(n, rising) (INTCON2bits.INTEDG##n = (rising))
+
+/***************************************** EEPROM *******************************************/
+#define hal_eeprom_busy()       (EECON1bits.WR)
+#define hal_eeprom_write(address, data) do { EEADRH = (address) >> 8;                         \
+                                     EEADR = (address);                                       \
+                                     EEDATA = (data);                                         \
+                                     EECON1bits.EEPGD = 0;                                    \
+                                     EECON1bits.CFGS  = 0;                                    \
+                                     EECON1bits.WREN  = 1;                                    \
+                                     INTCONbits.GIE   = 0;                                    \
+                                     EECON2 = 0x55;         /* required sequence start */     \
+                                     EECON2 = 0xAA;                                           \
+                                     EECON1bits.WR    = 1;                                    \
+                                     INTCONbits.GIE   = 1;  /* required sequence end */       \
+                                } while (0)
+#define hal_eeprom_fetch(address)   do { EEADRH = (address) >> 8;                             \
+                                     EEADR = (address);                                       \
+                                     EECON1bits.EEPGD = 0;                                    \
+                                     EECON1bits.CFGS  = 0;                                    \
+                                     EECON1bits.RD    = 1;                                    \
+                                } while (0)
+#define hal_eeprom_data()       (EEDATA)
+
+#endif
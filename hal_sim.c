@@ -0,0 +1,598 @@
+/*********************************************************************************************/
+/* hal_sim.c - virtual PIC18F4525 behind hal_sim.h, runs a firmware as a Linux program       */
+/* Models TMR0-TMR2, the USART (byte timing from SPBRG, 2-deep receive FIFO, OERR), the A/D */
+/* (conversion time, sticky ADIF), ports A-E, INT0-INT2 edges, the data EEPROM (4 ms write)  */
+/* and the serial LCD on the USART, all against one virtual clock in instruction cycles.     */
+/* -m adds the heliostat mechanics: two DC motors on RD4-RD7 with Hall sensors on INT0/INT1  */
+/* and home switches on RD2/RD3.                                                             */
+/* Update history: 10/17/2026 initiated                                                      */
+/*********************************************************************************************/
+#define HAL_SIM_IMPL
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "hal.h"
+
+#define ADC_CYCLES      26          // 2 TAD acquisition + 11 TAD conversion, TAD = 2 us
+#define EEPROM_CYCLES   4000        // Data EEPROM write time, 4 ms
+#define EEPROM_SIZE     1024
+#define RX_FIFO         2
+#define RX_BYTE_MS      0.08        // One byte on the wire at SPBRG = 1, 10 x 16 x 2 cycles
+#define MAX_EVENTS      4096
+#define COST_SLICE      100         // Cycles of hal_cost() between interrupt checks
+
+void firmware_main(void);
+void isr(void);
+
+struct source {                     // What an A/D channel sees
+    unsigned char *data;            // Samples, replayed in a loop, or NULL for a fixed level
+    unsigned long n, rate;          // Number of samples, samples per second
+    unsigned char level;
+};
+
+struct event {                      // One line of the -s script
+    unsigned long at;               // Cycle the event fires
+    char kind;                      // 'p' input pin level, 'r' received USART byte
+    unsigned char port, bit, value;
+};
+
+static unsigned long now, limit = 10UL * (SIM_FOSC / 4), isr_count, idle_cycles;
+static unsigned char in_isr, gie, peie, quiet;
+
+static unsigned char tris[5] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF }, lat[5], pins[5];
+static unsigned char int_if[3], int_ie[3], int_edge[3] = { 1, 1, 1 };
+
+static unsigned char t0_on, t0_if, t0_ie;
+static unsigned long t0_count, t0_ps = 1, t0_pre;  // Prescaler ratio and its count
+static unsigned char t2_on, t2_if, t2_ie;
+static unsigned long t2_period, t2_acc;
+static unsigned char t1_on;
+static unsigned long t1_base;
+static unsigned char t3_on, t3_if, t3_ie;
+static unsigned long t3_base, t3_wraps, t3_ps = 1;   // Count = (now - t3_base) / t3_ps
+
+static unsigned char spbrg = 25, txie, txreg, txreg_full, tsr, tsr_busy;
+static unsigned long tsr_done, uart_bytes;
+static unsigned char rx_fifo[RX_FIFO], rx_n, rcie, oerr;
+static unsigned long rx_overruns;
+
+static struct source src[13];
+static struct gate {                /* -g: light added to a channel while an output pin is high */
+    unsigned char ch, port, bit;
+    struct source s;
+} gates[4];
+static unsigned int gate_n;
+static unsigned char adc_ch, adc_busy, adif, adresh;
+static unsigned long adc_done_at, adc_sampled_at;
+
+static struct motor {               /* -m: RD4/RD5 pan +/-, RD6/RD7 tilt +/- */
+    long pos;                       // Hall pulses above the home switch
+    double frac, speed;             // Part of the next pulse, pulses per second
+} motors[2];
+static double motor_pps;            // Speed at full drive, 0 = no motors
+#define MOTOR_TAU       0.05        // Spin-up time constant, s; coasts MOTOR_TAU x speed
+#define MOTOR_START     3000        // Pulses from home at power-up
+
+static unsigned char eeprom[EEPROM_SIZE], ee_data, ee_busy;
+static unsigned long ee_done_at;
+static const char *ee_file;
+
+static struct event events[MAX_EVENTS];
+static unsigned int ev_n, ev_i;
+
+static FILE *dac_log, *uart_log;
+static unsigned long dac_writes;
+static unsigned char ddram[128], lcd_cursor, lcd_cmd, lcd_dirty, lcd_trace;
+static unsigned long lcd_shown_at;
+
+static void sim_finish(void);
+
+/*************************************** Serial LCD *****************************************/
+static void lcd_show(FILE *f) {
+    fprintf(f, "[%10.6f s] |%.16s|%.16s|\n", now / (double)(SIM_FOSC / 4), (char *)ddram,
+            (char *)ddram + 64);
+}
+
+static void lcd_byte(unsigned char c) { /* SerLCD: 254 = command prefix, 124 = backlight */
+    if (lcd_cmd == 254) {
+        lcd_cmd = 0;
+        if (c == 0x01) {
+            memset(ddram, ' ', sizeof ddram);
+            lcd_cursor = 0;
+        }
+        else if (c & 0x80) lcd_cursor = c & 0x7F;
+        lcd_dirty = 1;
+        return;
+    }
+    if (lcd_cmd == 124) {           // Backlight level, nothing to show
+        lcd_cmd = 0;
+        return;
+    }
+    if (c == 254 || c == 124) {
+        lcd_cmd = c;
+        return;
+    }
+    if (c == 18) return;            // Ctl R, baud rate reset
+    ddram[lcd_cursor] = c < 32 ? ' ' : c;   // HD44780 ROM codes 0x10-0x1F are blank
+    lcd_cursor = (lcd_cursor + 1) & 0x7F;
+    lcd_dirty = 1;
+}
+
+/**************************************** Core loop *****************************************/
+static unsigned char source_value(struct source *s) {
+    if (!s->data) return s->level;
+    return s->data[(adc_sampled_at * s->rate / (SIM_FOSC / 4)) % s->n];
+}
+
+static unsigned char adc_sample(unsigned char ch) {
+    unsigned int i, v = source_value(&src[ch]);
+    for (i = 0; i < gate_n; i++)
+        if (gates[i].ch == ch && (lat[gates[i].port] >> gates[i].bit & 1)
+            && !(tris[gates[i].port] >> gates[i].bit & 1)) v += source_value(&gates[i].s);
+    return v > 255 ? 255 : v;
+}
+
+static void pin_input(unsigned char port, unsigned char bit, unsigned char value) {
+    unsigned char mask = 1 << bit, old = pins[port] & mask;
+    if (value) pins[port] |= mask;
+    else pins[port] &= ~mask;
+    if (port == SIM_PORT_B && bit <= 2 && old != (pins[port] & mask) && (tris[port] & mask)
+        && (value != 0) == int_edge[bit]) int_if[bit] = 1;
+}
+
+static void motor_step(unsigned long n) { /* first-order speed, one Hall pulse per unit */
+    unsigned char i, drive;
+    double dt = n / (double)(SIM_FOSC / 4), k = dt / MOTOR_TAU;
+    for (i = 0; i < 2; i++) {
+        struct motor *m = &motors[i];
+        drive = (lat[SIM_PORT_D] & ~tris[SIM_PORT_D]) >> (4 + 2 * i) & 3;
+        m->speed += ((drive == 1 ? motor_pps : drive == 2 ? -motor_pps : 0) - m->speed)
+                    * (k > 1 ? 1 : k);
+        m->frac += m->speed * dt;
+        if (m->frac >= 1 || m->frac < 0) {  // Falling edge on INTi, back up right away
+            m->pos += m->frac >= 1 ? 1 : -1;
+            m->frac -= m->frac >= 1 ? 1 : -1;
+            pin_input(SIM_PORT_B, i, 0);
+            pin_input(SIM_PORT_B, i, 1);
+        }
+        pin_input(SIM_PORT_D, 2 + i, m->pos <= 0);  // Home switch closed
+    }
+}
+
+static void sim_step(unsigned long n) { /* advance every peripheral by n cycles */
+    now += n;
+    if (motor_pps) motor_step(n);
+    if (t0_on) {
+        t0_pre += n;
+        t0_count += t0_pre / t0_ps;
+        t0_pre %= t0_ps;
+        if (t0_count > 0xFFFF) {
+            t0_count &= 0xFFFF;
+            t0_if = 1;
+        }
+    }
+    if (t3_on && (now - t3_base) / t3_ps >> 16 != t3_wraps) {
+        t3_wraps = (now - t3_base) / t3_ps >> 16;
+        t3_if = 1;
+    }
+    if (t2_on) {
+        t2_acc += n;
+        while (t2_acc >= t2_period) {
+            t2_acc -= t2_period;
+            t2_if = 1;
+        }
+    }
+    if (tsr_busy && now >= tsr_done) {
+        tsr_busy = 0;
+        uart_bytes++;
+        if (uart_log) fputc(tsr, uart_log);
+        if (spbrg == 25) lcd_byte(tsr);
+    }
+    if (!tsr_busy && txreg_full) {  // TXREG -> TSR, TXIF goes back up
+        tsr = txreg;
+        txreg_full = 0;
+        tsr_busy = 1;
+        tsr_done = now + 40UL * (spbrg + 1);    // 10 bits x 16 x (SPBRG + 1) / 4
+    }
+    if (adc_busy && now >= adc_done_at) {
+        adc_busy = 0;
+        adresh = adc_sample(adc_ch);
+        adif = 1;
+    }
+    if (ee_busy && now >= ee_done_at) ee_busy = 0;
+    while (ev_i < ev_n && events[ev_i].at <= now) {
+        struct event *e = &events[ev_i++];
+        if (e->kind == 'p') pin_input(e->port, e->bit, e->value);
+        else if (!oerr && rx_n < RX_FIFO) rx_fifo[rx_n++] = e->value;
+        else {                      // Lost; the receiver stays off until CREN is toggled
+            oerr = 1;
+            rx_overruns++;
+        }
+    }
+    if (lcd_trace && lcd_dirty && now - lcd_shown_at >= SIM_FOSC / 40) {   // 100 ms
+        lcd_dirty = 0;
+        lcd_shown_at = now;
+        lcd_show(stdout);
+    }
+}
+
+static unsigned char irq_pending(void) {
+    return (t0_if && t0_ie) || (int_if[0] && int_ie[0]) || (int_if[1] && int_ie[1])
+        || (int_if[2] && int_ie[2])
+        || (peie && ((t2_if && t2_ie) || (t3_if && t3_ie) || (!txreg_full && txie) || (rx_n && rcie)));
+}
+
+static void sim_tick(unsigned long n) { /* charge n cycles, then take any due interrupt */
+    sim_step(n);
+    while (!in_isr && gie && irq_pending()) {
+        in_isr = 1;                 // Hardware clears GIE on entry, RETFIE sets it again
+        gie = 0;
+        isr_count++;
+        sim_step(SIM_ISR_CYCLES);
+        isr();
+        gie = 1;
+        in_isr = 0;
+        if (now >= limit) break;
+    }
+    if (now >= limit) sim_finish();
+}
+
+unsigned long sim_now(void) { return now; }
+void sim_spin(void) { sim_tick(SIM_SPIN_CYCLES); }
+void sim_cost(unsigned int n) {     /* in slices: interrupts come in during long work */
+    for (; n > COST_SLICE; n -= COST_SLICE) sim_tick(COST_SLICE);
+    sim_tick(n);
+}
+void sim_idle(void) {               /* SLEEP with IDLEN: the clock runs, the CPU waits */
+    sim_tick(SIM_HAL_CYCLES);
+    while (!irq_pending()) {        // Any enabled flag wakes the CPU, whatever GIE is
+        sim_step(1);
+        idle_cycles++;
+        if (now >= limit) sim_finish();
+    }
+    sim_tick(0);                    // With GIE on, isr() runs before the next instruction
+}
+
+/****************************************** A/D *********************************************/
+void sim_adc_init(void) { sim_tick(3 * SIM_HAL_CYCLES); tris[SIM_PORT_A] = 0xFF; }
+void sim_adc_select(unsigned char ch) { sim_tick(SIM_HAL_CYCLES); adc_ch = ch % 13; adif = 0; }
+void sim_adc_start(void) {
+    sim_tick(SIM_HAL_CYCLES);
+    adc_busy = 1;
+    adc_sampled_at = now;
+    adc_done_at = now + ADC_CYCLES;
+}
+unsigned char sim_adc_done(void) { sim_tick(SIM_HAL_CYCLES); return adif; }
+unsigned char sim_adc_result(void) { sim_tick(SIM_HAL_CYCLES); return adresh; }
+
+/**************************************** Timers ********************************************/
+void sim_tmr0_start(unsigned char ps) {
+    sim_tick(SIM_HAL_CYCLES);
+    t0_on = 1;
+    t0_ps = ps & 0x08 ? 1 : 2UL << (ps & 7);    // PSA set: no prescaler
+}
+void sim_tmr0_reload(unsigned char h, unsigned char l) {
+    sim_tick(SIM_HAL_CYCLES);
+    t0_count = ((unsigned long)h << 8) | l;
+    t0_pre = 0;                     // A write to TMR0 clears the prescaler
+}
+unsigned char sim_tmr0_pending(void) { sim_tick(SIM_HAL_CYCLES); return t0_if; }
+void sim_tmr0_ack(void) { sim_tick(SIM_HAL_CYCLES); t0_if = 0; }
+void sim_tmr0_irq(unsigned char on) { sim_tick(SIM_HAL_CYCLES); t0_ie = on != 0; }
+void sim_tmr2_start(unsigned char t2con, unsigned char pr2) {
+    static const unsigned char prescale[4] = { 1, 4, 16, 16 };
+    sim_tick(2 * SIM_HAL_CYCLES);
+    t2_on = (t2con >> 2) & 1;
+    t2_period = (unsigned long)prescale[t2con & 3] * (pr2 + 1) * (((t2con >> 3) & 15) + 1);
+    t2_acc = 0;
+}
+unsigned char sim_tmr2_pending(void) { sim_tick(SIM_HAL_CYCLES); return t2_if; }
+void sim_tmr2_ack(void) { sim_tick(SIM_HAL_CYCLES); t2_if = 0; }
+void sim_tmr2_irq(unsigned char on) { sim_tick(SIM_HAL_CYCLES); t2_ie = on != 0; }
+unsigned char sim_tmr2_irq_on(void) { sim_tick(SIM_HAL_CYCLES); return t2_ie; }
+void sim_tmr1_start(void) { sim_tick(SIM_HAL_CYCLES); t1_on = 1; t1_base = now; }
+unsigned short sim_tmr1_read(void) {
+    sim_tick(2 * SIM_HAL_CYCLES);
+    return t1_on ? (unsigned short)(now - t1_base) : 0;
+}
+void sim_tmr3_start(unsigned char ps) {
+    sim_tick(SIM_HAL_CYCLES);
+    t3_on = 1;
+    t3_ps = 1UL << (ps & 3);
+    t3_base = now;
+    t3_wraps = 0;
+}
+unsigned short sim_tmr3_read(void) {
+    sim_tick(2 * SIM_HAL_CYCLES);
+    return t3_on ? (unsigned short)((now - t3_base) / t3_ps) : 0;
+}
+unsigned char sim_tmr3_pending(void) { sim_tick(SIM_HAL_CYCLES); return t3_if; }
+void sim_tmr3_ack(void) { sim_tick(SIM_HAL_CYCLES); t3_if = 0; }
+void sim_tmr3_irq(unsigned char on) { sim_tick(SIM_HAL_CYCLES); t3_ie = on != 0; }
+
+/***************************************** USART ********************************************/
+void sim_uart_init(unsigned char value) { sim_tick(6 * SIM_HAL_CYCLES); spbrg = value; }
+void sim_uart_baud(unsigned char value) { sim_tick(SIM_HAL_CYCLES); spbrg = value; }
+unsigned char sim_uart_tx_ready(void) { sim_tick(SIM_HAL_CYCLES); return !txreg_full; }
+void sim_uart_put(unsigned char c) {
+    sim_tick(SIM_HAL_CYCLES);
+    txreg = c;
+    txreg_full = 1;
+    sim_step(0);                    // Moves straight on to the TSR if the line is idle
+}
+void sim_uart_tx_irq(unsigned char on) { sim_tick(SIM_HAL_CYCLES); txie = on != 0; }
+unsigned char sim_uart_tx_irq_on(void) { sim_tick(SIM_HAL_CYCLES); return txie; }
+unsigned char sim_uart_rx_ready(void) { sim_tick(SIM_HAL_CYCLES); return rx_n != 0; }
+unsigned char sim_uart_get(void) {
+    unsigned char c;
+    sim_tick(SIM_HAL_CYCLES);
+    if (!rx_n) return 0;
+    c = rx_fifo[0];
+    memmove(rx_fifo, rx_fifo + 1, --rx_n);
+    return c;
+}
+void sim_uart_rx_irq(unsigned char on) { sim_tick(SIM_HAL_CYCLES); rcie = on != 0; }
+unsigned char sim_uart_rx_overrun(void) { sim_tick(SIM_HAL_CYCLES); return oerr; }
+void sim_uart_rx_restart(void) { sim_tick(2 * SIM_HAL_CYCLES); oerr = 0; }
+
+/***************************************** GPIO *********************************************/
+void sim_port_dir(unsigned char port, unsigned char value) { sim_tick(SIM_HAL_CYCLES); tris[port] = value; }
+void sim_port_write(unsigned char port, unsigned char value) {
+    sim_tick(SIM_HAL_CYCLES);
+    lat[port] = value;
+    if (port == SIM_PORT_D) {
+        dac_writes++;
+        if (dac_log) fprintf(dac_log, "%lu,%u\n", now, value);
+    }
+}
+unsigned char sim_pin_read(unsigned char port, unsigned char bit) {
+    sim_tick(SIM_HAL_CYCLES);
+    return ((tris[port] & (1 << bit) ? pins[port] : lat[port]) >> bit) & 1;
+}
+void sim_pin_write(unsigned char port, unsigned char bit, unsigned char value) {
+    sim_tick(SIM_HAL_CYCLES);
+    if (value) lat[port] |= 1 << bit;
+    else lat[port] &= ~(1 << bit);
+}
+void sim_pin_toggle(unsigned char port, unsigned char bit) {
+    sim_pin_write(port, bit, !sim_pin_read(port, bit));
+}
+
+/************************************** Interrupts ******************************************/
+void sim_irq_enable(unsigned char on) { gie = on != 0; sim_tick(SIM_HAL_CYCLES); }
+void sim_irq_peripherals(void) { peie = 1; sim_tick(SIM_HAL_CYCLES); }
+unsigned char sim_int_pending(unsigned char n) { sim_tick(SIM_HAL_CYCLES); return int_if[n]; }
+void sim_int_ack(unsigned char n) { sim_tick(SIM_HAL_CYCLES); int_if[n] = 0; }
+void sim_int_irq(unsigned char n, unsigned char on) { int_ie[n] = on != 0; sim_tick(SIM_HAL_CYCLES); }
+void sim_int_edge(unsigned char n, unsigned char rising) { sim_tick(SIM_HAL_CYCLES); int_edge[n] = rising != 0; }
+
+/***************************************** EEPROM *******************************************/
+unsigned char sim_eeprom_busy(void) { sim_tick(SIM_HAL_CYCLES); return ee_busy; }
+void sim_eeprom_write(unsigned short address, unsigned char data) {
+    sim_tick(10 * SIM_HAL_CYCLES);
+    eeprom[address % EEPROM_SIZE] = data;
+    ee_busy = 1;
+    ee_done_at = now + EEPROM_CYCLES;
+}
+void sim_eeprom_fetch(unsigned short address) {
+    sim_tick(4 * SIM_HAL_CYCLES);
+    ee_data = eeprom[address % EEPROM_SIZE];
+}
+unsigned char sim_eeprom_data(void) { sim_tick(SIM_HAL_CYCLES); return ee_data; }
+
+/**************************************** Options *******************************************/
+static void load_samples(struct source *s, char *spec) { /* file[@Hz] or =level */
+    char *at, *dot;
+    FILE *f;
+    unsigned long cap = 4096;
+    int c, v;
+    if (*spec == '=') {
+        s->level = (unsigned char)atoi(spec + 1);
+        return;
+    }
+    s->rate = 1000;
+    if ((at = strrchr(spec, '@')) != NULL) {
+        *at = 0;
+        s->rate = strtoul(at + 1, NULL, 10);
+    }
+    if ((f = fopen(spec, "rb")) == NULL) {
+        perror(spec);
+        exit(2);
+    }
+    s->data = malloc(cap);
+    dot = strrchr(spec, '.');
+    if (dot && (!strcmp(dot, ".csv") || !strcmp(dot, ".txt"))) {    // one value per line
+        char line[256];
+        while (fgets(line, sizeof line, f)) {
+            if (sscanf(line, "%d", &v) != 1) continue;
+            if (s->n == cap) s->data = realloc(s->data, cap *= 2);
+            s->data[s->n++] = v < 0 ? 0 : v > 255 ? 255 : v;
+        }
+    }
+    else {                          // raw 8-bit samples
+        while ((c = fgetc(f)) != EOF) {
+            if (s->n == cap) s->data = realloc(s->data, cap *= 2);
+            s->data[s->n++] = (unsigned char)c;
+        }
+    }
+    fclose(f);
+    if (!s->n || !s->rate) {
+        fprintf(stderr, "sim: no samples in %s\n", spec);
+        exit(2);
+    }
+}
+
+static void add_event(double ms, char kind, unsigned char port, unsigned char bit, unsigned char value) {
+    struct event *e;
+    unsigned int i;
+    if (ev_n == MAX_EVENTS) {
+        fprintf(stderr, "sim: more than %d script events\n", MAX_EVENTS);
+        exit(2);
+    }
+    for (i = ev_n++; i > 0 && events[i - 1].at > ms * 1000; i--) events[i] = events[i - 1];
+    e = &events[i];
+    e->at = (unsigned long)(ms * 1000);
+    e->kind = kind;
+    e->port = port;
+    e->bit = bit;
+    e->value = value;
+}
+
+static void load_script(const char *name) {
+    /* <ms> pin <port> <bit> <0|1>    set an input pin level              */
+    /* <ms> pulse <port> <bit> <ms>   invert an input pin for a while     */
+    /* <ms> rx <byte> [<byte>...]     bytes arriving on the USART, back   */
+    /*                                to back at 115200 from <ms> on      */
+    FILE *f = fopen(name, "r");
+    char line[256], cmd[16], port;
+    double ms, len;
+    int bit, value, n, used;
+    if (!f) {
+        perror(name);
+        exit(2);
+    }
+    while (fgets(line, sizeof line, f)) {
+        if (sscanf(line, "%lf %15s%n", &ms, cmd, &used) != 2) continue;   // blank or # comment
+        if (!strcmp(cmd, "pin") && sscanf(line + used, " %c %d %d", &port, &bit, &value) == 3)
+            add_event(ms, 'p', port - 'A', bit, value != 0);
+        else if (!strcmp(cmd, "pulse") && sscanf(line + used, " %c %d %lf", &port, &bit, &len) == 3) {
+            add_event(ms, 'p', port - 'A', bit, 0xFF);
+            add_event(ms + len, 'p', port - 'A', bit, 0xFE);
+        }
+        else if (!strcmp(cmd, "rx")) {
+            char *p = line + used;
+            while (sscanf(p, "%i%n", &value, &n) == 1) {
+                add_event(ms, 'r', 0, 0, (unsigned char)value);
+                ms += RX_BYTE_MS;
+                p += n;
+            }
+        }
+        else fprintf(stderr, "sim: %s: ignoring %s", name, line);
+    }
+    fclose(f);
+}
+
+static void load_source(char *arg) { /* ch:file[@Hz] or ch:=level */
+    char *spec = strchr(arg, ':');
+    if (!spec || atoi(arg) < 0 || atoi(arg) > 12) {
+        fprintf(stderr, "sim: bad -a %s\n", arg);
+        exit(2);
+    }
+    load_samples(&src[atoi(arg)], spec + 1);
+}
+
+static void load_gate(char *arg) { /* ch:Xbit:file[@Hz] or ch:Xbit:=level */
+    struct gate *g = &gates[gate_n];
+    char *spec = strchr(arg, ':');
+    if (gate_n == 4 || !spec || atoi(arg) < 0 || atoi(arg) > 12 || spec[1] < 'A' || spec[1] > 'E'
+        || spec[2] < '0' || spec[2] > '7' || spec[3] != ':') {
+        fprintf(stderr, "sim: bad -g %s\n", arg);
+        exit(2);
+    }
+    g->ch = atoi(arg);
+    g->port = spec[1] - 'A';
+    g->bit = spec[2] - '0';
+    load_samples(&g->s, spec + 4);
+    gate_n++;
+}
+
+static void resolve_pulses(void) { /* 0xFF / 0xFE: flip the level the pin has by then */
+    unsigned char level[5];
+    unsigned int i;
+    memcpy(level, pins, sizeof level);
+    for (i = 0; i < ev_n; i++) {
+        struct event *e = &events[i];
+        if (e->kind != 'p' || e->port > 4) continue;
+        if (e->value >= 0xFE) e->value = !((level[e->port] >> e->bit) & 1);
+        if (e->value) level[e->port] |= 1 << e->bit;
+        else level[e->port] &= ~(1 << e->bit);
+    }
+}
+
+static void sim_finish(void) {
+    FILE *f;
+    if (!quiet) {
+        fprintf(stderr, "sim: %.6f s, %lu interrupts, %lu USART bytes, %lu PORTD writes",
+                now / (double)(SIM_FOSC / 4), isr_count, uart_bytes, dac_writes);
+        if (rx_overruns) fprintf(stderr, ", %lu RX overruns", rx_overruns);
+        if (idle_cycles) fprintf(stderr, ", %.1f%% idle", 100.0 * idle_cycles / now);
+        fprintf(stderr, "\n");
+        if (motor_pps) fprintf(stderr, "sim: pan at %ld, tilt at %ld Hall pulses from home\n",
+                               motors[0].pos, motors[1].pos);
+        lcd_show(stderr);
+    }
+    if (ee_file && (f = fopen(ee_file, "wb")) != NULL) {
+        fwrite(eeprom, 1, sizeof eeprom, f);
+        fclose(f);
+    }
+    if (dac_log) fclose(dac_log);
+    if (uart_log) fclose(uart_log);
+    exit(0);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  -t sec           virtual run time (default 10)\n"
+        "  -a ch:file[@Hz]  feed A/D channel from raw 8-bit or .csv/.txt samples (default 1000 Hz)\n"
+        "  -a ch:=level     hold A/D channel at a fixed level (default 128)\n"
+        "  -g ch:Xb:file[@Hz] or ch:Xb:=level\n"
+        "                   add to A/D channel ch while output pin Xb is high (LED light)\n"
+        "  -p X=value       initial input levels of port X, e.g. -p B=0x04\n"
+        "  -s file          event script (pin, pulse, rx)\n"
+        "  -d file          log PORTD writes as cycle,value\n"
+        "  -u file          write raw USART output\n"
+        "  -e file          EEPROM image, loaded at start and saved at exit\n"
+        "  -m pps           heliostat motors, full speed in Hall pulses per second\n"
+        "  -l               print the LCD whenever it changes\n"
+        "  -q               no summary at exit\n", prog);
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    FILE *f;
+    int opt, i;
+    for (i = 0; i < 13; i++) src[i].level = 128;
+    memset(eeprom, 0xFF, sizeof eeprom);
+    memset(ddram, ' ', sizeof ddram);
+    while ((opt = getopt(argc, argv, "t:a:g:p:s:d:u:e:m:lq")) != -1) {
+        switch (opt) {
+        case 't': limit = (unsigned long)(atof(optarg) * (SIM_FOSC / 4)); break;
+        case 'a': load_source(optarg); break;
+        case 'g': load_gate(optarg); break;
+        case 'p':
+            if (optarg[0] < 'A' || optarg[0] > 'E' || optarg[1] != '=') usage(argv[0]);
+            pins[optarg[0] - 'A'] = (unsigned char)strtoul(optarg + 2, NULL, 0);
+            break;
+        case 's': load_script(optarg); break;
+        case 'd':
+            if ((dac_log = fopen(optarg, "w")) == NULL) { perror(optarg); exit(2); }
+            break;
+        case 'u':
+            if ((uart_log = fopen(optarg, "wb")) == NULL) { perror(optarg); exit(2); }
+            break;
+        case 'e':
+            ee_file = optarg;
+            if ((f = fopen(optarg, "rb")) != NULL) {
+                if (fread(eeprom, 1, sizeof eeprom, f) != sizeof eeprom)
+                    fprintf(stderr, "sim: %s is short, rest left erased\n", optarg);
+                fclose(f);
+            }
+            break;
+        case 'm':
+            motor_pps = atof(optarg);
+            motors[0].pos = motors[1].pos = MOTOR_START;
+            pins[SIM_PORT_B] |= 0x03;   // Hall outputs idle high
+            break;
+        case 'l': lcd_trace = 1; break;
+        case 'q': quiet = 1; break;
+        default: usage(argv[0]);
+        }
+    }
+    if (optind != argc) usage(argv[0]);
+    resolve_pulses();
+    firmware_main();
+    sim_finish();
+    return 0;
+}
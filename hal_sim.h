@@ -0,0 +1,129 @@
+/*********************************************************************************************/
+/* hal_sim.h - Linux backend of hal.h: every call lands in the virtual PIC of hal_sim.c      */
+/* Time is counted in instruction cycles (Fosc/4 = 1 us at 4 MHz). Each HAL call costs a     */
+/* few cycles, and the simulator runs isr() in between calls whenever an enabled flag is up. */
+/* Update history: 10/17/2026 initiated                                                      */
+/*********************************************************************************************/
+#ifndef HAL_SIM_H
+#define HAL_SIM_H
+
+#define interrupt                   // XC8 keyword; the simulator calls isr() itself
+#ifndef HAL_SIM_IMPL
+#define main firmware_main          // hal_sim.c owns the real main() and its options
+#endif
+
+#define SIM_FOSC        4000000UL   // Oscillator the firmwares are timed for
+#define SIM_HAL_CYCLES  2           // Cost charged for one SFR access
+#define SIM_SPIN_CYCLES 12          // One pass of a busy-wait loop (Delay_ms: 82 x 12 ~ 1 ms)
+#define SIM_ISR_CYCLES  40          // Interrupt latency + XC8 context save/restore
+
+enum { SIM_PORT_A, SIM_PORT_B, SIM_PORT_C, SIM_PORT_D, SIM_PORT_E };
+
+unsigned long sim_now(void);
+void sim_spin(void);
+void sim_adc_init(void);
+void sim_adc_select(unsigned char ch);
+void sim_adc_start(void);
+unsigned char sim_adc_done(void);
+unsigned char sim_adc_result(void);
+void sim_tmr0_start(unsigned char ps);
+void sim_tmr0_reload(unsigned char h, unsigned char l);
+unsigned char sim_tmr0_pending(void);
+void sim_tmr0_ack(void);
+void sim_tmr0_irq(unsigned char on);
+void sim_tmr2_start(unsigned char t2con, unsigned char pr2);
+unsigned char sim_tmr2_pending(void);
+void sim_tmr2_ack(void);
+void sim_tmr2_irq(unsigned char on);
+unsigned char sim_tmr2_irq_on(void);
+void sim_tmr1_start(void);
+unsigned short sim_tmr1_read(void);
+void sim_tmr3_start(unsigned char ps);
+unsigned short sim_tmr3_read(void);
+unsigned char sim_tmr3_pending(void);
+void sim_tmr3_ack(void);
+void sim_tmr3_irq(unsigned char on);
+void sim_cost(unsigned int n);
+void sim_idle(void);
+void sim_uart_init(unsigned char spbrg);
+void sim_uart_baud(unsigned char spbrg);
+unsigned char sim_uart_tx_ready(void);
+void sim_uart_put(unsigned char c);
+void sim_uart_tx_irq(unsigned char on);
+unsigned char sim_uart_tx_irq_on(void);
+unsigned char sim_uart_rx_ready(void);
+unsigned char sim_uart_get(void);
+void sim_uart_rx_irq(unsigned char on);
+unsigned char sim_uart_rx_overrun(void);
+void sim_uart_rx_restart(void);
+void sim_port_dir(unsigned char port, unsigned char tris);
+void sim_port_write(unsigned char port, unsigned char value);
+unsigned char sim_pin_read(unsigned char port, unsigned char bit);
+void sim_pin_write(unsigned char port, unsigned char bit, unsigned char value);
+void sim_pin_toggle(unsigned char port, unsigned char bit);
+void sim_irq_enable(unsigned char on);
+void sim_irq_peripherals(void);
+unsigned char sim_int_pending(unsigned char n);
+void sim_int_ack(unsigned char n);
+void sim_int_irq(unsigned char n, unsigned char on);
+void sim_int_edge(unsigned char n, unsigned char rising);
+unsigned char sim_eeprom_busy(void);
+void sim_eeprom_write(unsigned short address, unsigned char data);
+void sim_eeprom_fetch(unsigned short address);
+unsigned char sim_eeprom_data(void);
+
+#define hal_spin()                      sim_spin()
+#define hal_cost(n)                     sim_cost(n)
+#define hal_idle()                      sim_idle()
+#define hal_adc_init()                  sim_adc_init()
+#define hal_adc_select(ch)              sim_adc_select(ch)
+#define hal_adc_start()                 sim_adc_start()
+#define hal_adc_done()                  sim_adc_done()
+#define hal_adc_result()                sim_adc_result()
+#define hal_dac_write(value)            sim_port_write(SIM_PORT_D, (value))
+#define hal_tmr0_start(ps)              sim_tmr0_start(ps)
+#define hal_tmr0_reload(h, l)           sim_tmr0_reload((h), (l))
+#define hal_tmr0_pending()              sim_tmr0_pending()
+#define hal_tmr0_ack()                  sim_tmr0_ack()
+#define hal_tmr0_irq(on)                sim_tmr0_irq(on)
+#define hal_tmr2_start(t2con, pr2)      sim_tmr2_start((t2con), (pr2))
+#define hal_tmr2_pending()              sim_tmr2_pending()
+#define hal_tmr2_ack()                  sim_tmr2_ack()
+#define hal_tmr2_irq(on)                sim_tmr2_irq(on)
+#define hal_tmr2_irq_on()               sim_tmr2_irq_on()
+#define hal_tmr1_start()                sim_tmr1_start()
+#define hal_tmr1_read()                 sim_tmr1_read()
+#define hal_tmr3_start(ps)              sim_tmr3_start(ps)
+#define hal_tmr3_read()                 sim_tmr3_read()
+#define hal_tmr3_pending()              sim_tmr3_pending()
+#define hal_tmr3_ack()                  sim_tmr3_ack()
+#define hal_tmr3_irq(on)                sim_tmr3_irq(on)
+#define hal_uart_init(spbrg)            sim_uart_init(spbrg)
+#define hal_uart_baud(spbrg)            sim_uart_baud(spbrg)
+#define hal_uart_tx_ready()             sim_uart_tx_ready()
+#define hal_uart_put(c)                 sim_uart_put(c)
+#define hal_uart_tx_irq(on)             sim_uart_tx_irq(on)
+#define hal_uart_tx_irq_on()            sim_uart_tx_irq_on()
+#define hal_uart_rx_ready()             sim_uart_rx_ready()
+#define hal_uart_get()                  sim_uart_get()
+#define hal_uart_rx_irq(on)             sim_uart_rx_irq(on)
+#define hal_uart_rx_overrun()           sim_uart_rx_overrun()
+#define hal_uart_rx_restart()           sim_uart_rx_restart()
+#define hal_port_dir(port, tris)        sim_port_dir(SIM_PORT_##port, (tris))
+#define hal_port_write(port, value)     sim_port_write(SIM_PORT_##port, (value))
+#define hal_pin_read(port, bit)         sim_pin_read(SIM_PORT_##port, (bit))
+#define hal_pin_write(port, bit, value) sim_pin_write(SIM_PORT_##port, (bit), (value))
+#define hal_pin_toggle(port, bit)       sim_pin_toggle(SIM_PORT_##port, (bit))
+#define hal_irq_enable()                sim_irq_enable(1)
+#define hal_irq_disable()               sim_irq_enable(0)
+#define hal_irq_peripherals()           sim_irq_peripherals()
+#define hal_int_pending(n)              sim_int_pending(n)
+#define hal_int_ack(n)                  sim_int_ack(n)
+#define hal_int_irq(n, on)              sim_int_irq((n), (on))
+#define hal_int_edge(n, rising)         sim_int_edge((n), (rising))
+#define hal_eeprom_busy()               sim_eeprom_busy()
+#define hal_eeprom_write(address, data) sim_eeprom_write((address), (data))
+#define hal_eeprom_fetch(address)       sim_eeprom_fetch(address)
+#define hal_eeprom_data()               sim_eeprom_data()
+
+#endif
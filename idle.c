@@ -0,0 +1,35 @@
+/*********************************************************************************************/
+/* idle.c - IDLE mode for main(), see idle.h                                                 */
+/* The test and SLEEP run with GIE off, so no interrupt can post a task in between; an       */
+/* enabled flag still ends IDLE mode, and isr() runs when GIE is back on. The sleep is timed */
+/* with TimeUs(), from just before SLEEP to the return of that isr(); the percentage costs   */
+/* one division per window.                                                                  */
+/* Update history: 10/17/2026 initiated                                                      */
+/*********************************************************************************************/
+#include "hal.h"
+#include "sched.h"
+#include "eelog.h"
+#include "idle.h"
+
+unsigned char idle_pct;
+static unsigned long asleep;        // us asleep since mark
+static unsigned long mark;          // TimeUs() at the start of the window
+
+void Idle(){  /****************** main(): sleep until the next interrupt, if nothing to do ***/
+    unsigned long t;
+    t = TimeUs();
+    if (t - mark >= IDLE_WINDOW) {
+        idle_pct = asleep * 100 / (t - mark);
+        asleep = 0;
+        mark = t;
+    }
+    hal_irq_disable();              // Until after SLEEP: a post now wakes it up instead
+    if (SchedReady() || !EeIdle()) {    // Work to do, or an EEPROM write to follow up
+        hal_irq_enable();
+        return;
+    }
+    t = TimeUs();
+    hal_idle();
+    hal_irq_enable();               // isr() of the interrupt that woke the CPU runs here
+    asleep += TimeUs() - t;
+}
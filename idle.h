@@ -0,0 +1,29 @@
+/*********************************************************************************************/
+/* idle.h - IDLE mode for main() between interrupts, and the share of time spent in it       */
+/* main() calls Idle() when SchedRun() found nothing to run. Unless a task is ready or due,  */
+/* or EeService() still has EEPROM work (EeIdle()), it stops the CPU until the next enabled  */
+/* interrupt: TMR0 (the tick), INT0-INT2 (Hall sensors, buttons), RX, TX, TMR2 or TMR3.      */
+/* It is IDLE mode, not SLEEP: SLEEP stops the oscillator, and with it TMR0, TMR3 and the    */
+/* USART. The CPU core is most of the current, so this saves most of it.                     */
+/*                                                                                           */
+/* Interrupts are off from the test through SLEEP, so no isr() can post a task in between    */
+/* and leave it waiting through a sleep: the enabled flag wakes the CPU, GIE or not, and     */
+/* isr() runs a few cycles later, when Idle() turns GIE back on.                             */
+/*                                                                                           */
+/* idle_pct is the time asleep over the last IDLE_WINDOW or longer, in percent; the isr()    */
+/* that ends a sleep counts as asleep. It is updated by Idle() only: a main() that never     */
+/* runs out of work leaves it at its last value. Needs TimeStart(), see timebase.h.          */
+/* Update history: 10/17/2026 initiated                                                      */
+/*********************************************************************************************/
+#ifndef IDLE_H
+#define IDLE_H
+
+#include "timebase.h"
+
+#define IDLE_WINDOW     TIME_MS(1000)   // us between idle_pct updates
+
+extern unsigned char idle_pct;      // Percent of the time asleep
+
+void Idle();                        // main(): sleep until the next interrupt, if nothing to do
+
+#endif
@@ -0,0 +1,105 @@
+/*********************************************************************************************/
+/* isrprof.c - ISR cycle budget profiler, see isrprof.h                                      */
+/* Update history: 10/17/2026 initiated                                                      */
+/*********************************************************************************************/
+#include "hal.h"
+#include "isrprof.h"
+#include "usart.h"
+#include "fmt.h"
+#include "sched.h"
+#include "idle.h"
+
+struct prof prof[PROF_SLOTS];
+unsigned short prof_t0;             // TMR1 at ProfEnter()
+static unsigned char prof_prev = 0xFF;  // Slot of the previous ProfExit()
+
+void ProfClear(){  /************************* Forget everything recorded so far **************/
+    unsigned char i, b;
+    for (i = 0; i < PROF_SLOTS; i++) {
+        prof[i].count = prof[i].sum = 0;
+        prof[i].min = prof[i].period = 0xFFFF;
+        prof[i].max = 0;
+        for (b = 0; b < PROF_BINS; b++) prof[i].hist[b] = 0;
+    }
+    prof_prev = 0xFF;
+}
+
+void ProfStart(){  /******************** TMR1 free-running at Fosc/4, clear slots *************/
+    ProfClear();
+    hal_tmr1_start();
+}
+
+#if ISR_PROFILE
+void ProfExit(unsigned char slot){  /******** Record one ProfEnter()..ProfExit() stretch ******/
+    struct prof *p;
+    unsigned short dt, x;
+    unsigned char bin;
+    dt = hal_tmr1_read() - prof_t0;     // 16-bit wrap-around keeps this right up to 65 ms
+    if (slot >= PROF_SLOTS) return;
+    p = &prof[slot];
+    if (slot == prof_prev) {            // Entry-to-entry only within one function
+        x = prof_t0 - p->last;
+        if (x < p->period) p->period = x;
+    }
+    p->last = prof_t0;
+    prof_prev = slot;
+    p->count++;
+    p->sum += dt;
+    if (dt < p->min) p->min = dt;
+    if (dt > p->max) p->max = dt;
+    bin = 0;                            // log2 bins starting at 64 cycles
+    for (x = dt >> 6; x && bin < PROF_BINS - 1; x >>= 1) bin++;
+    if (p->hist[bin] != 0xFFFF) p->hist[bin]++;
+}
+#endif
+
+static void ProfPut(unsigned char c){  /***** Queue one byte, waiting for room if needed *****/
+    while (!TxBTFree()) hal_spin();
+    TransmitBT(c);
+}
+
+static void ProfText(const char *s){
+    while (*s) ProfPut(*s++);
+}
+
+static void ProfNum(unsigned long value, unsigned char width){  /** right-aligned decimal ***/
+    unsigned char digits[FMT_MAX], n, i;
+    n = FmtNum(digits, value, width, FMT_UNSIGNED);
+    for (i = 0; i < n; i++) ProfPut(digits[i]);
+}
+
+void ProfDump(){  /************* Print the tables, main() only: waits on the queue ***********/
+    unsigned char i, b;
+    struct prof p;
+    struct sched t;
+    ProfText("\r\nfn   count   min   avg   max period  <64 <128 <256 <512  <1k  <2k  <4k more\r\n");
+    for (i = 0; i < PROF_SLOTS; i++) {
+        hal_irq_disable();              // Take a consistent copy
+        p = prof[i];
+        hal_irq_enable();
+        if (!p.count) continue;
+        ProfNum(i, 2);
+        ProfNum(p.count, 8);
+        ProfNum(p.min, 6);
+        ProfNum(p.sum / p.count, 6);
+        ProfNum(p.max, 6);
+        if (p.period == 0xFFFF) ProfText("      -");
+        else ProfNum(p.period, 7);
+        for (b = 0; b < PROF_BINS; b++) ProfNum(p.hist[b], 5);
+        ProfText("\r\n");
+    }
+    ProfText("\r\ntask      runs worst budget overruns late\r\n");
+    for (i = 0; i < sched_tasks; i++) {
+        t = sched[i];                   // Statistics: written by main() only
+        ProfNum(i, 4);
+        ProfNum(t.runs, 10);
+        ProfNum(t.worst, 6);
+        ProfNum(t.budget, 7);
+        ProfNum(t.overruns, 9);
+        ProfNum(t.late, 5);
+        ProfText("\r\n");
+    }
+    ProfText("\r\nasleep");
+    ProfNum(idle_pct, 4);
+    ProfText("%\r\n");
+}
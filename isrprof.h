@@ -0,0 +1,47 @@
+/*********************************************************************************************/
+/* isrprof.h - ISR cycle budget profiler                                                     */
+/* ProfEnter()/ProfExit(slot) bracket a stretch of isr() and record its length in            */
+/* instruction cycles (us at 4 MHz) per slot: count, min, average, max, a log2 histogram     */
+/* and the shortest time between two entries, i.e. the budget actually available.           */
+/* TMR1 is the clock on the PIC; on the host it is the simulator's cycle model.              */
+/* Build with -DISR_PROFILE=0 to compile the probes out.                                     */
+/* Update history: 10/17/2026 initiated                                                      */
+/*********************************************************************************************/
+#ifndef ISRPROF_H
+#define ISRPROF_H
+
+#include "hal.h"
+
+#ifndef ISR_PROFILE
+#define ISR_PROFILE     1
+#endif
+
+#define PROF_SLOTS      13          // One per function number
+#define PROF_BINS       8           // <64, <128, <256, ... <4096, more cycles
+
+struct prof {
+    unsigned long count, sum;
+    unsigned short min, max;        // Entry-to-exit cycles
+    unsigned short period;          // Shortest entry-to-entry cycles seen
+    unsigned short last;            // TMR1 at the previous entry
+    unsigned short hist[PROF_BINS]; // Saturate at 65535
+};
+
+extern struct prof prof[PROF_SLOTS];
+extern unsigned short prof_t0;
+
+#if ISR_PROFILE
+#define ProfEnter()     (prof_t0 = hal_tmr1_read())
+#else
+#define ProfEnter()
+#define ProfExit(slot)
+#endif
+
+void ProfStart();                   // Start TMR1 and clear all slots
+void ProfClear();
+#if ISR_PROFILE
+void ProfExit(unsigned char slot);
+#endif
+void ProfDump();                    // Print it, the sched.h tasks and idle_pct over Bluetooth
+
+#endif
@@ -0,0 +1,85 @@
+/*********************************************************************************************/
+/* lcd.c - LCD frame buffer and background diff, see lcd.h                                   */
+/* main() writes lcd_fb while isr() reads it: a cell changed during a scan sets dirty again, */
+/* so it goes out on the next one.                                                           */
+/* Update history: 10/17/2026 initiated                                                      */
+/*********************************************************************************************/
+#include "hal.h"
+#include "usart.h"
+#include "fmt.h"
+#include "lcd.h"
+
+#define LCD_NOWHERE     0xFF        // Display cursor unknown or off screen
+
+unsigned char lcd_fb[LCD_CELLS];
+static unsigned char shown[LCD_CELLS];      // What the display has
+static unsigned char cursor;                // DDRAM address of the next LcdPut()
+static volatile unsigned char dirty;        // lcd_fb may differ from shown
+static unsigned char at = LCD_NOWHERE;      // Cell the display cursor is on
+static unsigned char move;                  // Second byte of a cursor move, 0 if none
+
+static unsigned char Cell(unsigned char address){  /*** Index in lcd_fb, LCD_CELLS if none ***/
+    if (address < LCD_COLS) return address;
+    if (address >= LCD_LINE2 && address < LCD_LINE2 + LCD_COLS)
+        return address - LCD_LINE2 + LCD_COLS;
+    return LCD_CELLS;
+}
+
+void LcdReset(){  /***************** Both copies blank, behind a real clear of the display ***/
+    unsigned char i;
+    for (i = 0; i < LCD_CELLS; i++) lcd_fb[i] = shown[i] = ' ';
+    cursor = 0;
+    at = 0;                         // Clear display homes the cursor
+    move = 0;
+    dirty = 0;
+    Transmit(254);                  // See datasheets for Serial LCD and HD44780
+    Transmit(0x01);
+}
+
+void LcdGoto(unsigned char address){
+    cursor = address;
+}
+
+void LcdPut(unsigned char c){  /********************************* One character, RAM only ***/
+    unsigned char i;
+    i = Cell(cursor++);
+    if (i < LCD_CELLS && lcd_fb[i] != c) {
+        lcd_fb[i] = c;
+        dirty = 1;
+        hal_tmr2_irq(1);            // Wake the LCD pacing tick, see usart.c
+    }
+}
+
+void LcdPrint(const unsigned char *s, unsigned char n){
+    while (n--) LcdPut(*s++);
+}
+
+void LcdNum(unsigned char address, long value, unsigned char width, unsigned int flags){
+    unsigned char buf[FMT_MAX];
+    LcdGoto(address);
+    LcdPrint(buf, FmtNum(buf, value, width, flags));
+}
+
+unsigned char LcdNext(unsigned char *c){  /*************** isr(): the next byte to send ***/
+    unsigned char i;
+    if (move) {                     // Address byte of a cursor move
+        *c = move;
+        move = 0;
+        return 1;
+    }
+    if (!dirty) return 0;
+    dirty = 0;                      // Before the scan: main() may set it again meanwhile
+    for (i = 0; i < LCD_CELLS; i++) if (lcd_fb[i] != shown[i]) break;
+    if (i == LCD_CELLS) return 0;
+    dirty = 1;                      // Maybe more after this one
+    if (i != at && at + 1 != i) {   // (LCD_NOWHERE + 1 is 256, never a cell)
+        *c = 254;                   // Cursor move: 254, then 128 + address
+        move = 128 + (i < LCD_COLS ? i : i - LCD_COLS + LCD_LINE2);
+        at = i;
+        return 1;
+    }
+    if (at + 1 == i) i = at;        // One unchanged cell in between: resend it, 1 byte not 2
+    *c = shown[i] = lcd_fb[i];
+    at = i == LCD_COLS - 1 || i == LCD_CELLS - 1 ? LCD_NOWHERE : i + 1;
+    return 1;
+}
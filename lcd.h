@@ -0,0 +1,30 @@
+/*********************************************************************************************/
+/* lcd.h - frame buffer for the 16x2 serial LCD, sent by difference in the background        */
+/* LcdGoto() / LcdPut() / LcdPrint() only write RAM: lcd_fb holds what the display should    */
+/* show, a second copy what it shows now. TxService() asks LcdNext() for a byte whenever the */
+/* LCD queue of usart.c is empty and the pacing gap is over, and gets the next changed cell, */
+/* with a cursor move (254, 128 + address) only when the cell does not follow the last one   */
+/* sent. A redraw of a line that mostly stays the same costs the few cells that changed,     */
+/* and printing never waits for the LCD.                                                     */
+/*                                                                                           */
+/* Addresses are the HD44780's, as SetPosition() always used: 0-15 line 1, 64-79 line 2.     */
+/* Writes to any other address are dropped, like the invisible DDRAM of the display.         */
+/* Update history: 10/17/2026 initiated                                                      */
+/*********************************************************************************************/
+#ifndef LCD_H
+#define LCD_H
+
+#define LCD_COLS        16
+#define LCD_CELLS       (2 * LCD_COLS)
+#define LCD_LINE2       64          // DDRAM address of line 2
+
+void LcdReset();                    // Clear the display itself (254, 1) and both copies
+void LcdGoto(unsigned char address);
+void LcdPut(unsigned char c);       // At the cursor, which moves on
+void LcdPrint(const unsigned char *s, unsigned char n);
+void LcdNum(unsigned char address, long value, unsigned char width, unsigned int flags);  // fmt.h
+unsigned char LcdNext(unsigned char *c);    // From TxService(): 1 and the byte, 0 if in sync
+
+extern unsigned char lcd_fb[LCD_CELLS];     // Line 1, then line 2
+
+#endif
@@ -0,0 +1,49 @@
+/*********************************************************************************************/
+/* median.c - sliding-window median of 8-bit samples, see median.h                           */
+/* Update history: 10/17/2026 initiated                                                      */
+/*********************************************************************************************/
+#include "hal.h"
+#include "median.h"
+
+static unsigned char ring[MEDIAN_MAX];      // Samples in arrival order, oldest at ring[next]
+static unsigned char sorted[MEDIAN_MAX];    // Same samples in ascending order
+static unsigned char next;                  // Ring slot to overwrite with the next sample
+unsigned char median_size;
+
+void MedianInit(unsigned char size, unsigned char fill){  /***** Start over with a full window */
+    unsigned char k;
+    if (size < 1) size = 1;                 // 0 would wrap to 255 below
+    if (size > MEDIAN_MAX) size = MEDIAN_MAX;
+    if (!(size & 1)) size--;                // Odd, so the median is a single sample
+    for (k = 0; k < size; k++) ring[k] = sorted[k] = fill;
+    median_size = size;
+    next = 0;
+}
+
+unsigned char MedianPush(unsigned char sample){  /*** Replace the oldest sample, return median */
+    unsigned char old, lo, hi, k;
+    old = ring[next];
+    ring[next] = sample;
+    if (++next == median_size) next = 0;
+    lo = 0;                                 // Binary search for a slot holding the old value
+    hi = median_size - 1;
+    for (;;) {
+        hal_cost(20);                       // Cycle model: one halving step
+        k = (lo + hi) >> 1;
+        if (sorted[k] == old) break;
+        if (sorted[k] < old) lo = k + 1;
+        else hi = k - 1;
+    }
+    while (k > 0 && sorted[k - 1] > sample) {   // Slide down past larger samples
+        hal_cost(14);                       // Cycle model: compare and move one byte
+        sorted[k] = sorted[k - 1];
+        k--;
+    }
+    while (k < median_size - 1 && sorted[k + 1] < sample) { // or up past smaller ones
+        hal_cost(14);
+        sorted[k] = sorted[k + 1];
+        k++;
+    }
+    sorted[k] = sample;
+    return sorted[median_size >> 1];
+}
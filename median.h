@@ -0,0 +1,18 @@
+/*********************************************************************************************/
+/* median.h - sliding-window median of 8-bit samples, updated incrementally                  */
+/* The window is kept twice: in arrival order (a ring) and sorted. Each new sample takes     */
+/* the sorted slot of the sample it pushes out of the ring and slides into place, so one     */
+/* update costs a binary search plus at most (size - 1) moves instead of a full sort.        */
+/* Update history: 10/17/2026 initiated                                                      */
+/*********************************************************************************************/
+#ifndef MEDIAN_H
+#define MEDIAN_H
+
+#define MEDIAN_MAX      31          // Largest window; sizes used: 5, 9, 15, 31 (odd)
+
+void MedianInit(unsigned char size, unsigned char fill);   // New window, 1..31, all = fill
+unsigned char MedianPush(unsigned char sample);             // Add a sample, return the median
+
+extern unsigned char median_size;
+
+#endif
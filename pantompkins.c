@@ -0,0 +1,143 @@
+/*********************************************************************************************/
+/* pantompkins.c - Pan-Tompkins QRS detector, see pantompkins.h                              */
+/* Ranges for 8-bit input: low-pass output 0..9180 is scaled by 1/16 before the high-pass,   */
+/* so its 32-sample running sum fits an int; the derivative magnitude is clipped to 255 so   */
+/* its square fits an unsigned int; only the integrator sum needs a long.                    */
+/* Update history: 10/17/2026 initiated                                                      */
+/*********************************************************************************************/
+#include "hal.h"
+#include "pantompkins.h"
+
+static unsigned char x_buf[16];     // Raw input, x(n-12) for the low-pass
+static int lp1, lp2;                // Low-pass y(n-1), y(n-2)
+static int hp_buf[32];              // Scaled low-pass output, for the high-pass
+static int hp_sum;                  // Running sum of hp_buf
+static int d_buf[8];                // High-pass output, for the derivative
+static unsigned int sq_buf[32];     // Squared derivative, integrator window
+static unsigned long mwi_sum;
+static unsigned char k;             // Ring position shared by all buffers (masked per buffer)
+static unsigned int pk;             // Largest integrator value of the peak being climbed
+static unsigned long pk_at;
+static unsigned int thr1, thr2;     // Primary and searchback thresholds
+static unsigned int sb_pk;          // Largest noise peak above thr2 since the last QRS
+static unsigned long sb_at;
+static unsigned int rr_buf[PT_RR_AVG], rr_n;
+static unsigned long rr_total;
+static unsigned int learn_max;
+static unsigned long learn_sum;
+
+unsigned long pt_n, pt_rpeak;
+unsigned int pt_rr, pt_rr_avg, pt_spki, pt_npki;
+unsigned char pt_beat;
+
+void PTInit(){  /********************************** Clear all filter state and thresholds ***/
+    unsigned char i;
+    for (i = 0; i < 16; i++) x_buf[i] = 0;
+    for (i = 0; i < 32; i++) hp_buf[i] = sq_buf[i] = 0;
+    for (i = 0; i < 8; i++) d_buf[i] = 0;
+    lp1 = lp2 = hp_sum = 0;
+    mwi_sum = 0;
+    k = 0;
+    pk = sb_pk = 0;
+    pt_n = pt_rpeak = 0;
+    pt_rr = pt_rr_avg = rr_n = 0;
+    rr_total = 0;
+    pt_spki = pt_npki = thr1 = thr2 = 0;
+    learn_max = 0;
+    learn_sum = 0;
+    pt_beat = 0;
+}
+
+static void Thresholds(){  /*********************** THRESHOLD I1 and I2 of the paper *********/
+    if (pt_spki > pt_npki) thr1 = pt_npki + ((pt_spki - pt_npki) >> 2);
+    else thr1 = pt_npki;
+    thr2 = thr1 >> 1;
+}
+
+static void Beat(unsigned long at){  /****************** Accept a QRS whose peak is at "at" **/
+    unsigned int rr;
+    if (pt_rpeak) {
+        rr = (unsigned int)(at - PT_DELAY - pt_rpeak);
+        pt_rr = rr;
+        rr_total -= rr_buf[rr_n & (PT_RR_AVG - 1)];
+        rr_buf[rr_n & (PT_RR_AVG - 1)] = rr;
+        rr_total += rr;
+        rr_n++;
+        if (rr_n >= PT_RR_AVG) pt_rr_avg = rr_total / PT_RR_AVG;
+        else pt_rr_avg = rr_total / rr_n;
+    }
+    pt_rpeak = at - PT_DELAY;
+    sb_pk = 0;
+    pt_beat = 1;
+}
+
+static void Peak(){  /***************** Classify the peak just passed as signal or noise *****/
+    if (pk > thr1 && pk_at - PT_DELAY - pt_rpeak > PT_REFRACTORY) {
+        pt_spki = pt_spki - (pt_spki >> 3) + (pk >> 3);     // SPKI = 0.125 PEAKI + 0.875 SPKI
+        Beat(pk_at);
+    }
+    else {
+        pt_npki = pt_npki - (pt_npki >> 3) + (pk >> 3);     // NPKI = 0.125 PEAKI + 0.875 NPKI
+        if (pk > thr2 && pk > sb_pk) {
+            sb_pk = pk;
+            sb_at = pk_at;
+        }
+    }
+    Thresholds();
+}
+
+unsigned char PTStep(unsigned char x){  /****************** One sample through the pipeline **/
+    int lp, hp, d;
+    unsigned int sq, mwi;
+    lp = 2 * lp1 - lp2 + x - 2 * x_buf[(k - 6) & 15] + x_buf[(k - 12) & 15];  // Low-pass
+    x_buf[k & 15] = x;
+    lp2 = lp1;
+    lp1 = lp;
+    lp >>= 4;
+    hp_sum += lp - hp_buf[k & 31];          // hp_buf[k] still holds x(n-32)
+    hp = hp_buf[(k - 16) & 31] - (hp_sum >> 5);                             // High-pass
+    hp_buf[k & 31] = lp;
+    d = 2 * hp + d_buf[(k - 1) & 7] - d_buf[(k - 3) & 7] - 2 * d_buf[(k - 4) & 7]; // d/dt
+    d_buf[k & 7] = hp;
+    d >>= 1;
+    if (d < 0) d = -d;                      // Only the square is needed from here on
+    if (d > 255) d = 255;
+    sq = (unsigned int)d * (unsigned int)d;                                 // Squaring
+    mwi_sum += sq;
+    mwi_sum -= sq_buf[k & 31];
+    sq_buf[k & 31] = sq;
+    mwi = (unsigned int)(mwi_sum >> 5);                                     // Integration
+    hal_cost(300);                          // Cycle model: filters, 16 x 16 square, long sum
+    k++;
+    pt_n++;
+    if (pt_n <= PT_LEARN) {                 // Training: SPKI = max / 3, NPKI = mean / 2
+        if (pt_n > PT_SETTLE) {             // Skip the filter start-up transient
+            if (mwi > learn_max) learn_max = mwi;
+            learn_sum += mwi;
+        }
+        if (pt_n == PT_LEARN) {
+            pt_spki = learn_max / 3;
+            pt_npki = learn_sum / (PT_LEARN - PT_SETTLE) / 2;
+            Thresholds();
+        }
+    }
+    else {
+        if (mwi > pk) {                     // Climbing a peak
+            pk = mwi;
+            pk_at = pt_n;
+        }
+        else if (mwi < (pk >> 1)) {         // Fallen to half: the peak is complete
+            Peak();
+            pk = 0;
+        }
+        if (pt_rr_avg && sb_pk &&           // Searchback after 1.625 x the average RR
+            pt_n - PT_DELAY - pt_rpeak > pt_rr_avg + (pt_rr_avg >> 1) + (pt_rr_avg >> 3)) {
+            pt_spki = pt_spki - (pt_spki >> 2) + (sb_pk >> 2);  // 0.25 PEAKI + 0.75 SPKI
+            Beat(sb_at);
+            Thresholds();
+        }
+    }
+    mwi >>= 2;
+    if (mwi > 255) mwi = 255;
+    return (unsigned char)mwi;
+}
@@ -0,0 +1,30 @@
+/*********************************************************************************************/
+/* pantompkins.h - Pan-Tompkins QRS detector, one 200 Hz sample per call, integer only       */
+/* Pan J, Tompkins WJ. A real-time QRS detection algorithm. IEEE TBME 32(3), 1985.           */
+/* Stages: low-pass (gain 36, 5 samples delay) and high-pass (32-tap, 16 samples delay)      */
+/* filters of the paper, 5-point derivative, squaring, 32-sample (160 ms) moving-window      */
+/* integration, then peak classification against the adaptive SPKI/NPKI thresholds with     */
+/* a 200 ms refractory period and searchback at 166% of the average RR interval.            */
+/* The first PT_LEARN samples only set up the thresholds.                                    */
+/* Update history: 10/17/2026 initiated                                                      */
+/*********************************************************************************************/
+#ifndef PANTOMPKINS_H
+#define PANTOMPKINS_H
+
+#define PT_LEARN        400         // 2 s of training before detection starts
+#define PT_SETTLE       128         // Filter start-up, left out of the training
+#define PT_REFRACTORY   40          // 200 ms: no second QRS closer than this
+#define PT_DELAY        31          // Integrator peak lags the R wave by this many samples
+#define PT_RR_AVG       8           // RR intervals averaged, must be a power of 2
+
+void PTInit();
+unsigned char PTStep(unsigned char x);  // Filter one sample, return the integrator as 8 bits
+
+extern unsigned long pt_n;          // Samples since PTInit(), i.e. number of the last one (1..)
+extern unsigned long pt_rpeak;      // Sample index of the last R wave
+extern unsigned int pt_rr;          // Last RR interval, samples
+extern unsigned int pt_rr_avg;      // Mean of the last PT_RR_AVG RR intervals, 0 if unknown
+extern unsigned char pt_beat;       // Set when a QRS is detected, cleared by the caller
+extern unsigned int pt_spki, pt_npki;   // Signal and noise peak levels of the integrator
+
+#endif
@@ -0,0 +1,71 @@
+/*********************************************************************************************/
+/* pipeline.c - sample blocks from isr() to main() and D/A values back, see pipeline.h       */
+/* One producer and one consumer per buffer, each index written by one side only, so no      */
+/* interrupt masking is needed except around BlockReset() from main().                       */
+/* Update history: 10/17/2026 initiated                                                      */
+/*********************************************************************************************/
+#include "hal.h"
+#include "pipeline.h"
+
+#define BLOCK_NONE      0xFF
+
+static unsigned char block[2][BLOCK_N];
+static unsigned char fill, fill_n, fill_tag;    // ISR side: block being filled
+static volatile unsigned char ready = BLOCK_NONE;   // Block handed to main(), if any
+static unsigned char dac_q[BLOCK_QSIZE];
+static volatile unsigned char dac_head, dac_tail;   // main() writes head, isr() tail
+static unsigned char primed, last;
+
+unsigned char block_tag, block_overruns, block_underruns;
+
+void BlockReset(unsigned char tag){  /*********** Start over, e.g. for a new function *********/
+    fill_n = 0;
+    fill_tag = tag;
+    dac_tail = dac_head;
+    primed = 0;
+}
+
+unsigned char BlockPut(unsigned char x){  /*************** Append a sample, hand over a block ***/
+    block[fill][fill_n] = x;
+    if (++fill_n < BLOCK_N) return 0;
+    fill_n = 0;
+    if (ready != BLOCK_NONE) {          // main() is behind: refill the same block
+        block_overruns++;
+        return 0;
+    }
+    block_tag = fill_tag;
+    ready = fill;
+    fill ^= 1;
+    return 1;
+}
+
+unsigned char BlockDac(){  /*************************************** Next queued D/A value *****/
+    unsigned char queued = (dac_head - dac_tail) & (BLOCK_QSIZE - 1);
+    if (!primed) {
+        if (queued <= BLOCK_N) return last;
+        primed = 1;
+    }
+    if (!queued) {
+        block_underruns++;
+        primed = 0;
+        return last;
+    }
+    last = dac_q[dac_tail];
+    dac_tail = (dac_tail + 1) & (BLOCK_QSIZE - 1);
+    return last;
+}
+
+unsigned char *BlockFull(){  /************************ Block waiting for main(), 0 if none *****/
+    return ready == BLOCK_NONE ? 0 : block[ready];
+}
+
+void BlockDone(){
+    ready = BLOCK_NONE;
+}
+
+void BlockOut(unsigned char y){  /************************ Queue a D/A value, dropped if full ***/
+    unsigned char head = (dac_head + 1) & (BLOCK_QSIZE - 1);
+    if (head == dac_tail) return;
+    dac_q[dac_head] = y;
+    dac_head = head;
+}
@@ -0,0 +1,29 @@
+/*********************************************************************************************/
+/* pipeline.h - sample blocks from isr() to main() and D/A values back                       */
+/* The ISR appends each A/D sample to one of two ping-pong blocks of BLOCK_N. When a block   */
+/* is full it is handed to main(), which filters the whole block in one go and queues the   */
+/* results for the D/A; the ISR writes one queued value per tick. D/A output starts once     */
+/* more than a block is queued, so main() has a full block time of slack: the D/A lags the   */
+/* A/D by two to three blocks (67-100 ms at 240 Hz).                                         */
+/* A block that fills while main() still holds the other one is dropped (block_overruns);    */
+/* a tick with nothing queued repeats the last value and waits for the queue to refill       */
+/* (block_underruns).                                                                        */
+/* Update history: 10/17/2026 initiated                                                      */
+/*********************************************************************************************/
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#define BLOCK_N         8           // Samples per block
+#define BLOCK_QSIZE     32          // D/A queue, power of 2, more than 2 x BLOCK_N
+
+void BlockReset(unsigned char tag); // Drop the partial block and the queue; tag the next ones
+unsigned char BlockPut(unsigned char x);    // isr(): one A/D sample, 1 if it filled a block
+unsigned char BlockDac();           // isr(): value for the D/A this tick
+unsigned char *BlockFull();         // main(): the block ready for processing, 0 if none
+void BlockDone();                   // main(): finished with it
+void BlockOut(unsigned char y);     // main(): queue one D/A value
+
+extern unsigned char block_tag;     // Tag of the block BlockFull() returns
+extern unsigned char block_overruns, block_underruns;
+
+#endif
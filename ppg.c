@@ -0,0 +1,114 @@
+/*********************************************************************************************/
+/* ppg.c - photoplethysmogram of function 10: red / IR synchronous demodulation, see ppg.h  */
+/* Runs inside isr(): per tick a switch on the phase, per output sample a few 16/32-bit adds */
+/* per channel, no multiply or divide.                                                       */
+/* Update history: 10/17/2026 initiated                                                      */
+/*********************************************************************************************/
+#include "hal.h"
+#include "ppg.h"
+
+unsigned char ppg_led, ppg_red, ppg_ir, ppg_out, ppg_pulse;
+int ppg_ac[2], ppg_amp[2];
+unsigned int ppg_dc[2], ppg_level[2], ppg_interval;
+static unsigned char phase, cycle, lit, off, started;
+static int sum[2];                      // Demodulated, two cycles
+static unsigned long dc[2];             // Running mean x 256
+static int ac_max[2], ac_min[2];        // AC extremes since the last pulse peak
+static int hi, lo, trough, amp_avg;     // IR peak detector
+static unsigned char rising, quiet;    // quiet: samples since a pulse or halving of amp_avg
+static unsigned int since;              // Samples since the last pulse peak
+
+void PpgInit(){  /************************************ Start over, red LED first ***********/
+    phase = cycle = started = 0;
+    sum[0] = sum[1] = 0;
+    ac_max[0] = ac_max[1] = ac_min[0] = ac_min[1] = 0;
+    hi = lo = trough = amp_avg = 0;
+    rising = 1;
+    since = ppg_interval = 0;
+    quiet = 0;
+    ppg_pulse = 0;
+    off = 0;
+    ppg_led = PPG_LED_RED;
+}
+
+static void PpgChannel(unsigned char c, int x){  /******** DC and AC of one channel, 0-510 ***/
+    if (!started) dc[c] = (unsigned long)x << 8;    // No 2 s ramp at the start
+    dc[c] = dc[c] - (dc[c] >> 8) + x;               // DC = mean over 256 samples
+    ppg_dc[c] = dc[c] >> 8;
+    ppg_ac[c] = x - (int)ppg_dc[c];
+    if (ppg_ac[c] > ac_max[c]) ac_max[c] = ppg_ac[c];
+    if (ppg_ac[c] < ac_min[c]) ac_min[c] = ppg_ac[c];
+}
+
+static void PpgPeak(){  /*************************************** IR pulse peak detector *****/
+    int v, hyst;
+    v = ppg_ac[PPG_IR];
+    hyst = amp_avg >> 1;
+    if (hyst < PPG_MIN_HYST) hyst = PPG_MIN_HYST;
+    if (since < 0xFFFF) since++;
+    if (++quiet == PPG_LOST) {          // No pulse for 2 s: it got smaller
+        quiet = 0;
+        amp_avg >>= 1;
+    }
+    if (!rising) {                      // Falling: follow the trough
+        if (v < lo) lo = v;
+        else if (v > lo + hyst) {
+            rising = 1;
+            trough = lo;
+            hi = v;
+        }
+        return;
+    }
+    if (v > hi) hi = v;
+    else if (v < hi - hyst) {           // Turned down by more than the hysteresis: a peak
+        rising = 0;
+        lo = v;
+        if (since < PPG_MIN_PULSE) return;  // Dicrotic notch or noise
+        v = hi - trough;
+        if (v > amp_avg) amp_avg = v;   // Up at once, so a dicrotic wave never passes
+        else amp_avg -= (amp_avg - v) >> 3;
+        ppg_interval = since == 0xFFFF ? 0 : since;
+        since = quiet = 0;
+        ppg_amp[PPG_RED] = ac_max[PPG_RED] - ac_min[PPG_RED];
+        ppg_amp[PPG_IR] = ac_max[PPG_IR] - ac_min[PPG_IR];
+        ppg_level[PPG_RED] = ppg_dc[PPG_RED];
+        ppg_level[PPG_IR] = ppg_dc[PPG_IR];
+        ac_max[0] = ac_min[0] = ppg_ac[0];
+        ac_max[1] = ac_min[1] = ppg_ac[1];
+        ppg_pulse = 1;
+    }
+}
+
+unsigned char PpgTick(unsigned char x){  /************ One tick: demodulate, next LED state **/
+    int v;
+    unsigned char ready = 0;
+    switch (phase) {
+    case 0:                             // Red was lit
+    case 2:                             // IR was lit
+        lit = x;
+        break;
+    case 1:                             // Dark, after red and before IR
+    case 3:                             // Dark, after IR and before red
+        v = (int)lit - (((int)off + x) >> 1);
+        if (v > 0) sum[phase >> 1] += v;    // Less than ambient: LED not seen, count 0
+        off = x;
+        if (phase == 3 && ++cycle == 2) {   // Two cycles per output sample
+            cycle = 0;
+            PpgChannel(PPG_RED, sum[PPG_RED]);
+            PpgChannel(PPG_IR, sum[PPG_IR]);
+            started = 1;
+            ppg_red = sum[PPG_RED] >> 1;
+            ppg_ir = sum[PPG_IR] >> 1;
+            sum[0] = sum[1] = 0;
+            v = 128 + (ppg_ac[PPG_IR] << 1);  // x 4 in LSB
+            ppg_out = v < 0 ? 0 : v > 255 ? 255 : v;
+            PpgPeak();
+            ready = 1;
+            hal_cost(150);              // Cycle model: 32-bit DC updates and the detector
+        }
+        break;
+    }
+    phase = (phase + 1) & 3;
+    ppg_led = phase == 0 ? PPG_LED_RED : phase == 2 ? PPG_LED_IR : 0;
+    return ready;
+}
@@ -0,0 +1,48 @@
+/*********************************************************************************************/
+/* ppg.h - photoplethysmogram of function 10: red / IR synchronous demodulation              */
+/* The ISR lights the LEDs in a 4-tick cycle, red, off, IR, off, and hands PpgTick() the     */
+/* AN3 sample taken at the end of each tick, i.e. with the LED state of that tick:           */
+/*                                                                                           */
+/*     red = red on - (off before + off after) / 2    ir = IR on - (off before + after) / 2  */
+/*                                                                                           */
+/* so ambient light, including a 100/120 Hz flicker ramp, cancels and no half of the signal  */
+/* is averaged with LED-off samples. Two cycles are summed into one sample per channel:      */
+/* PPG_HZ = 125 Hz at PPG_TICK_HZ = 1 kHz.                                                   */
+/* Per channel: DC is a running mean over 256 samples (2 s), AC = sample - DC. Pulse peaks   */
+/* are found on the IR AC with a hysteresis of half the pulse amplitude, which follows a     */
+/* bigger pulse at once, so a dicrotic wave never gets through, and a smaller one over ~8    */
+/* pulses; it is halved after PPG_LOST without a pulse. Peaks are PPG_MIN_PULSE apart or     */
+/* more. At each peak the AC peak-to-peak and DC of both channels over the pulse are         */
+/* latched for SpO2:                                                                         */
+/* R = (AC red / DC red) / (AC IR / DC IR).                                                  */
+/* A board with only the red LED on RC3 still gets an ambient-free red channel.              */
+/* Update history: 10/17/2026 initiated                                                      */
+/*********************************************************************************************/
+#ifndef PPG_H
+#define PPG_H
+
+#define PPG_TICK_HZ     1000        // TMR0 rate of function 10, one LED phase per tick
+#define PPG_HZ          (PPG_TICK_HZ / 8)   // Demodulated samples per second per channel
+#define PPG_MIN_PULSE   (PPG_HZ * 3 / 10)   // 300 ms, 200 bpm
+#define PPG_MIN_HYST    2           // Smallest peak detection hysteresis, 1/2 LSB
+#define PPG_LOST        (PPG_HZ * 2)        // 2 s without a pulse: halve the hysteresis
+
+#define PPG_RED         0           // Channel index
+#define PPG_IR          1
+#define PPG_LED_RED     0x01        // ppg_led bits
+#define PPG_LED_IR      0x02
+
+void PpgInit();
+unsigned char PpgTick(unsigned char x);     // A/D sample of this tick; 1 when ppg_red/ir are new
+
+extern unsigned char ppg_led;       // LEDs to light for the next tick
+extern unsigned char ppg_red, ppg_ir;       // Demodulated samples, 8 bits
+extern unsigned char ppg_out;       // IR AC x 4 around 128, for the D/A
+extern int ppg_ac[2];               // AC of the last sample, 1/2 LSB
+extern unsigned int ppg_dc[2];      // DC, 1/2 LSB
+extern unsigned char ppg_pulse;     // Set at a pulse peak, cleared by the caller
+extern unsigned int ppg_interval;   // Samples between the last two pulse peaks, 0 if unknown
+extern int ppg_amp[2];              // AC peak-to-peak over the last pulse, 1/2 LSB
+extern unsigned int ppg_level[2];   // DC at the last pulse peak, 1/2 LSB
+
+#endif
@@ -0,0 +1,13 @@
+/*********************************************************************************************/
+/* rate.c - TMR0 reload for a sampling rate chosen at run time, see rate.h                   */
+/* Update history: 10/17/2026 initiated                                                      */
+/*********************************************************************************************/
+#include "rate.h"
+
+unsigned int RateReload(unsigned int hz, unsigned char latency){  /*** Same sum as RATE_RELOAD ***/
+    unsigned long count;
+    if (hz < RATE_MIN_HZ) return 0;
+    count = RATE_COUNT((unsigned long)hz);	// One 32-bit division
+    if (count > 0xFFFF || count <= latency / RATE_PRESCALE) return 0;	// Faster than the ISR
+    return 0xFFFF - (unsigned int)count + latency / RATE_PRESCALE;
+}
@@ -0,0 +1,59 @@
+/*********************************************************************************************/
+/* rate.h - TMR0 reload values for a sampling rate, computed from the crystal frequency      */
+/* TMR0 counts instruction cycles, _XTAL_FREQ / 4, through a prescaler; the ISR reloads it   */
+/* on every overflow, some cycles after the overflow itself. That latency depends on the     */
+/* ISR path, not on the crystal, and is added back to the reload:                            */
+/*                                                                                           */
+/*     reload = 0xFFFF - (Fcy / RATE_PRESCALE) / Hz + latency / RATE_PRESCALE                */
+/*                                                                                           */
+/* RATE_RELOAD() folds to a constant for constant arguments, so tables of reload values are  */
+/* built by the compiler; RateReload() does the same sum at run time for any rate.           */
+/* RATE_PRESCALE is the smallest prescaler that still fits RATE_MIN_HZ in 16 bits; start     */
+/* TMR0 with hal_tmr0_start(RATE_T0PS).                                                      */
+/* _XTAL_FREQ must be the same in every file of a project: define it in the project          */
+/* settings (-D_XTAL_FREQ=20000000) rather than in a .c file.                                */
+/* Update history: 10/17/2026 initiated                                                      */
+/*********************************************************************************************/
+#ifndef RATE_H
+#define RATE_H
+
+#ifndef _XTAL_FREQ
+#define _XTAL_FREQ      4000000     // Crystal, Hz
+#endif
+#ifndef RATE_MIN_HZ
+#define RATE_MIN_HZ     16          // Slowest rate any function asks for
+#endif
+#define RATE_LATENCY    50          // Cycles from overflow to reload in the common ISR path,
+                                    // (the original "adjust for delay by 50 us")
+#define RATE_FCY        (_XTAL_FREQ / 4)
+
+#if RATE_FCY / RATE_MIN_HZ < 65000
+#define RATE_PRESCALE   1
+#define RATE_T0PS       0x08        // PSA = 1: prescaler not assigned
+#elif RATE_FCY / 2 / RATE_MIN_HZ < 65000
+#define RATE_PRESCALE   2
+#define RATE_T0PS       0x00        // T0PS = 1:2 ... 1:256
+#elif RATE_FCY / 4 / RATE_MIN_HZ < 65000
+#define RATE_PRESCALE   4
+#define RATE_T0PS       0x01
+#elif RATE_FCY / 8 / RATE_MIN_HZ < 65000
+#define RATE_PRESCALE   8
+#define RATE_T0PS       0x02
+#elif RATE_FCY / 16 / RATE_MIN_HZ < 65000
+#define RATE_PRESCALE   16
+#define RATE_T0PS       0x03
+#elif RATE_FCY / 32 / RATE_MIN_HZ < 65000
+#define RATE_PRESCALE   32
+#define RATE_T0PS       0x04
+#else
+#error "rate.h: RATE_MIN_HZ is too low for this crystal"
+#endif
+
+#define RATE_COUNT(hz)          ((RATE_FCY / RATE_PRESCALE + (hz) / 2) / (hz))  // Rounded
+#define RATE_RELOAD(hz, lat)    ((unsigned int)(0xFFFF - RATE_COUNT(hz) + (lat) / RATE_PRESCALE))
+#define RATE_HIGH(hz, lat)      ((unsigned char)(RATE_RELOAD(hz, lat) >> 8))
+#define RATE_LOW(hz, lat)       ((unsigned char)RATE_RELOAD(hz, lat))
+
+unsigned int RateReload(unsigned int hz, unsigned char latency);    // 0 if out of range
+
+#endif
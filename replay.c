@@ -0,0 +1,121 @@
+/*********************************************************************************************/
+/* replay.c - run one BME363 filter function over a recorded signal, as fast as possible     */
+/* Links the same kernels the firmware calls (filter.c, dsp.c, median.c, pantompkins.c), so  */
+/* its output is what the PIC writes to the D/A for the same samples: a reference for any    */
+/* change to a kernel, checked against hours of recorded ECG.                                */
+/*   replay -f 9 ecg.csv out.csv                                                             */
+/* Input is raw 8-bit or .csv/.txt with one sample per line, as for the simulator's -a.      */
+/* Update history: 10/17/2026 initiated                                                      */
+/*********************************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "filter.h"
+#include "dsp.h"
+#include "median.h"
+#include "pantompkins.h"
+
+static unsigned long cost;
+
+void sim_cost(unsigned int n) { cost += n; }    // hal_cost() of the kernels lands here
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+        "usage: %s -f function [options] input [output]\n"
+        "  -f n     4 derivative, 5 low-pass, 6 hi-freq enhance, 7 notch, 8 median,\n"
+        "           9 MOBD, 12 Pan-Tompkins\n"
+        "  -s n     filter set for -f 4-7 (default: function - 4), see filter.c\n"
+        "  -w n     median window for -f 8 (5, 9, 15, 31; default 9)\n"
+        "  -t n     fixed MOBD threshold for -f 9 (default: adaptive)\n"
+        "  -r       write raw output bytes instead of n,in,out[,beat] lines\n"
+        "  -q       no summary\n"
+        "input is raw 8-bit or .csv/.txt, one sample per line; - reads text from stdin\n", prog);
+    exit(2);
+}
+
+static int next_sample(FILE *f, int text) {  /* next 0..255 sample, or -1 at the end */
+    char line[256];
+    int v;
+    if (!text) return (v = fgetc(f)) == EOF ? -1 : v;
+    while (fgets(line, sizeof line, f))
+        if (sscanf(line, "%d", &v) == 1) return v < 0 ? 0 : v > 255 ? 255 : v;
+    return -1;
+}
+
+int main(int argc, char **argv) {
+    FILE *in, *out = stdout;
+    int opt, function = -1, window = 9, set = -1, fixed = 0, raw = 0, quiet = 0, text, x, beat;
+    unsigned long n = 0, beats = 0, outliers = 0;
+    unsigned char y;
+    char *dot;
+    while ((opt = getopt(argc, argv, "f:w:s:t:rq")) != -1) {
+        switch (opt) {
+        case 'f': function = atoi(optarg); break;
+        case 'w': window = atoi(optarg); break;
+        case 's': set = atoi(optarg); break;
+        case 't': fixed = atoi(optarg); break;
+        case 'r': raw = 1; break;
+        case 'q': quiet = 1; break;
+        default: usage(argv[0]);
+        }
+    }
+    if ((function < 4 || function > 9) && function != 12) usage(argv[0]);
+    if (optind >= argc || optind + 2 < argc) usage(argv[0]);
+    if (set < 0) set = function >= 4 && function <= 7 ? function - 4 : 0;
+    if (set >= FILTER_SETS) usage(argv[0]);
+    if (window != 5 && window != 9 && window != 15 && window != 31) usage(argv[0]);
+    if (!strcmp(argv[optind], "-")) {
+        in = stdin;
+        text = 1;
+    }
+    else {
+        if ((in = fopen(argv[optind], "rb")) == NULL) { perror(argv[optind]); exit(2); }
+        dot = strrchr(argv[optind], '.');
+        text = dot && (!strcmp(dot, ".csv") || !strcmp(dot, ".txt"));
+    }
+    if (optind + 1 < argc && (out = fopen(argv[optind + 1], raw ? "wb" : "w")) == NULL) {
+        perror(argv[optind + 1]);
+        exit(2);
+    }
+    MedianInit(window, 0);
+    DspMOBDInit();
+    DspMOBDThreshold(fixed);
+    PTInit();
+    FilterSelect(set);
+    while ((x = next_sample(in, text)) >= 0) {
+        beat = 0;
+        switch (function) {
+        case 4:
+        case 5:
+        case 6:
+        case 7: y = FilterStep(x); break;
+        case 8: y = DspMedian(x); break;
+        case 9:
+            y = DspMOBD(x);
+            beat = refractory == 1;
+            outliers += beat && rr_status == RR_OUTLIER;
+            break;
+        default:
+            y = PTStep(x);
+            beat = pt_beat;
+            pt_beat = 0;
+            break;
+        }
+        beats += beat;
+        if (raw) fputc(y, out);
+        else if (function == 9 || function == 12) fprintf(out, "%lu,%d,%d,%d\n", n, x, y, beat);
+        else fprintf(out, "%lu,%d,%d\n", n, x, y);
+        n++;
+    }
+    if (!quiet) {
+        fprintf(stderr, "replay: function %d, %lu samples", function, n);
+        if (function == 9 || function == 12) fprintf(stderr, ", %lu beats", beats);
+        if (function == 9) fprintf(stderr, ", %d bpm over %d RR, %lu outliers, threshold %d",
+                                   mobd_hr, rr_n, outliers, threshold);
+        if (n) fprintf(stderr, ", %.1f annotated cycles/sample", cost / (double)n);
+        fprintf(stderr, "\n");
+    }
+    if (out != stdout) fclose(out);
+    return 0;
+}
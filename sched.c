@@ -0,0 +1,98 @@
+/*********************************************************************************************/
+/* sched.c - run-to-completion task scheduler, see sched.h                                   */
+/* isr() only counts ticks and sets ready bytes; everything else happens in SchedRun(). A    */
+/* task's since is written by whoever sets ready and read only while ready is still set.     */
+/* Update history: 10/17/2026 initiated                                                      */
+/*********************************************************************************************/
+#include "hal.h"
+#include "sched.h"
+
+struct sched sched[SCHED_TASKS];
+unsigned char sched_tasks;
+volatile unsigned short sched_now;
+
+static unsigned short Now(){  /******* sched_now from main(): two bytes, isr() may step it ***/
+    unsigned short t;
+    do t = sched_now;
+    while (t != sched_now);
+    return t;
+}
+
+void SchedInit(){
+    sched_tasks = 0;
+    hal_tmr1_start();               // Free-running, 1 count per cycle, see isrprof.h
+}
+
+unsigned char SchedAdd(sched_fn fn, unsigned short period, unsigned short budget){
+    struct sched *t;
+    if (sched_tasks == SCHED_TASKS) return SCHED_TASKS;     // Ignored by SchedPost()
+    t = &sched[sched_tasks];
+    t->fn = fn;
+    t->period = period;
+    t->next = Now() + period;
+    t->ready = 0;
+    t->budget = budget;
+    t->runs = 0;
+    t->worst = t->overruns = t->late = 0;
+    return sched_tasks++;
+}
+
+void SchedPost(unsigned char id){  /********************** Ready now, if not ready already ***/
+    struct sched *t;
+    if (id >= sched_tasks) return;
+    t = &sched[id];
+    if (t->ready) return;
+    t->since = Now();
+    t->ready = 1;
+}
+
+void SchedClear(){
+    unsigned char i;
+    for (i = 0; i < SCHED_TASKS; i++) {
+        sched[i].runs = 0;
+        sched[i].worst = sched[i].overruns = sched[i].late = 0;
+    }
+}
+
+unsigned char SchedRun(){  /*************** The first ready task, to completion; 0 if none ***/
+    struct sched *t;
+    unsigned short now, dt;
+    unsigned char i;
+    now = Now();
+    for (i = 0; i < sched_tasks; i++) {     // Periodic tasks that are due
+        t = &sched[i];
+        if (!t->period || (short)(now - t->next) < 0) continue;
+        hal_irq_disable();              // Against a SchedPost() between test and set
+        if (!t->ready) {
+            t->since = t->next;         // Late from when it was due
+            t->ready = 1;
+        }
+        hal_irq_enable();
+        t->next += t->period;
+        if ((short)(now - t->next) >= 0) t->next = now + t->period;   // Missed some: skip them
+    }
+    for (i = 0; i < sched_tasks; i++) if (sched[i].ready) break;
+    if (i == sched_tasks) return 0;
+    t = &sched[i];
+    dt = now - t->since;            // Still ready: isr() leaves since alone
+    if (dt > t->late) t->late = dt;
+    t->ready = 0;                   // A post from here on runs the task again
+    dt = hal_tmr1_read();
+    t->fn();
+    dt = hal_tmr1_read() - dt;
+    t->runs++;
+    if (dt > t->worst) t->worst = dt;
+    if (t->budget && dt > t->budget && t->overruns != 0xFFFF) t->overruns++;
+    return 1;
+}
+
+unsigned char SchedReady(){  /******************* What SchedRun() would find, runs nothing ***/
+    unsigned short now;
+    unsigned char i;
+    now = Now();
+    for (i = 0; i < sched_tasks; i++) {
+        if (sched[i].ready) return 1;
+        if (sched[i].period && (short)(now - sched[i].next) >= 0) return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,53 @@
+/*********************************************************************************************/
+/* sched.h - run-to-completion task scheduler for main()                                     */
+/* main() adds its tasks once, then only calls SchedRun(): it runs the first ready task in   */
+/* the order they were added, so that order is the priority, and returns 0 when none is      */
+/* ready (time for background work such as EeService()). A task is ready when               */
+/*                                                                                           */
+/*   period > 0    period ticks have passed since it was last due (periodic task)            */
+/*   SchedPost()   was called for it, from isr() or main(); posts before it runs coalesce    */
+/*                                                                                           */
+/* The tick is SchedTick() in the TMR0 branch of isr(). Tasks run to completion: one that    */
+/* waits holds up all the others, so a task should do one step of its work and return.      */
+/*                                                                                           */
+/* Every run is timed with TMR1 in instruction cycles (us at 4 MHz), interrupts included.    */
+/* The watchdog is the budget: a run that takes longer counts as an overrun. Per task:       */
+/* runs, the longest run, overruns and the longest wait from ready (posted or due) to run,   */
+/* in ticks. Runs over 65 ms wrap around in the 16-bit timer and show up shorter.            */
+/* Update history: 10/17/2026 initiated                                                      */
+/*********************************************************************************************/
+#ifndef SCHED_H
+#define SCHED_H
+
+#define SCHED_TASKS     8           // Size of the task table
+
+typedef void (*sched_fn)(void);
+
+struct sched {
+    sched_fn fn;
+    unsigned short period;          // Ticks between runs, 0: only when posted
+    unsigned short next;            // Tick the periodic task is due next
+    unsigned short since;           // Tick it became ready
+    volatile unsigned char ready;
+    unsigned short budget;          // Cycles a run may take, 0 for no limit
+    unsigned long runs;
+    unsigned short worst;           // Longest run, cycles
+    unsigned short overruns;        // Runs over budget, saturate at 65535
+    unsigned short late;            // Longest wait to run, ticks
+};
+
+extern struct sched sched[SCHED_TASKS];
+extern unsigned char sched_tasks;   // Entries of sched[] in use
+extern volatile unsigned short sched_now;   // Ticks since SchedInit()
+
+#define SchedTick()     (sched_now++)
+#define SchedTicks(n)   (sched_now += (n))     // n at once, from a slower TMR0
+
+void SchedInit();                   // Empty table, TMR1 running
+unsigned char SchedAdd(sched_fn fn, unsigned short period, unsigned short budget);  // Task id
+void SchedPost(unsigned char id);   // isr() or main(): run the task soon
+unsigned char SchedRun();           // main(): 1 if a task ran
+unsigned char SchedReady();         // Any task ready or due: 0 lets main() sleep, see idle.h
+void SchedClear();                  // Forget the statistics
+
+#endif
@@ -0,0 +1,149 @@
+/*********************************************************************************************/
+/* servo.c - pan/tilt position servo with ramps and learned coast, see servo.h               */
+/* ServoControl() and ServoPwm() run in isr(); call ServoMove() and ServoStop() with the     */
+/* TMR0 interrupt off. The only division is the deceleration cap, 16 bits by a constant.     */
+/* Update history: 10/17/2026 initiated                                                      */
+/*********************************************************************************************/
+#include "hal.h"
+#include "servo.h"
+
+#define DRIVE_PLUS(axis)    (0x10 << 2 * (axis))    // RD4 pan +, RD6 tilt +
+#define DRIVE_MINUS(axis)   (0x20 << 2 * (axis))    // RD5 pan -, RD7 tilt -
+
+unsigned char servo_state[2], servo_duty[2], servo_plus[2], servo_fault[2];
+int servo_coast[2];
+static long target[2], cut[2], last[2];     // Goal, where the drive was cut, previous tick
+static unsigned char ticks[2], tries[2];    // Ticks in this state, starts left
+static unsigned char learn[2], phase;       // Coast to be measured, PWM step
+static unsigned char quiet[2];              // Ticks under power without a Hall pulse
+static unsigned int home_left[2];           // Ticks before homing gives up
+
+void ServoInit(){  /****************************************************** Both axes idle ***/
+    unsigned char i;
+    for (i = 0; i < 2; i++) {
+        servo_state[i] = SERVO_IDLE;
+        servo_duty[i] = 0;
+        servo_coast[i] = SERVO_COAST0;
+        servo_fault[i] = SERVO_OK;
+    }
+}
+
+static void Start(unsigned char axis, long pos){  /************** Drive toward the target ***/
+    servo_plus[axis] = target[axis] > pos;
+    servo_duty[axis] = SERVO_MIN_DUTY;
+    servo_state[axis] = SERVO_RUN;
+    ticks[axis] = quiet[axis] = 0;
+}
+
+static void Accelerate(unsigned char axis){  /************ One step every SERVO_RAMP ticks ***/
+    if (ticks[axis] < 255) ticks[axis]++;
+    if (ticks[axis] % SERVO_RAMP == 0 && servo_duty[axis] < SERVO_PWM) servo_duty[axis]++;
+}
+
+static unsigned char Stalled(unsigned char axis, long pos){  /******* Powered, not turning ***/
+    if (pos != last[axis]) quiet[axis] = 0;
+    else if (++quiet[axis] >= SERVO_STALL) {
+        servo_duty[axis] = 0;
+        servo_state[axis] = SERVO_IDLE;
+        servo_fault[axis] = SERVO_STALLED;
+        return 1;
+    }
+    return 0;
+}
+
+void ServoMove(unsigned char axis, long goal){  /******** Started by the next control tick ***/
+    target[axis] = goal;
+    tries[axis] = SERVO_TRIES + 1;
+    servo_fault[axis] = SERVO_OK;
+    if (servo_state[axis] == SERVO_IDLE) {  // Stopped: ServoControl() checks the band first
+        servo_state[axis] = SERVO_COAST;
+        learn[axis] = 0;
+        ticks[axis] = SERVO_SETTLE;
+    }
+}
+
+void ServoHome(unsigned char axis){  /************* Minus at full ramp to the home switch ***/
+    servo_plus[axis] = 0;
+    servo_duty[axis] = SERVO_MIN_DUTY;
+    servo_state[axis] = SERVO_HOMING;
+    servo_fault[axis] = SERVO_OK;
+    ticks[axis] = quiet[axis] = 0;
+    home_left[axis] = SERVO_HOME_TIME;
+}
+
+void ServoStop(){  /*********************************** Power off; isr() counts the coast ***/
+    servo_state[SERVO_PAN] = servo_state[SERVO_TILT] = SERVO_IDLE;
+    servo_duty[SERVO_PAN] = servo_duty[SERVO_TILT] = 0;
+}
+
+unsigned char ServoBusy(){
+    return servo_state[SERVO_PAN] != SERVO_IDLE || servo_state[SERVO_TILT] != SERVO_IDLE;
+}
+
+unsigned char ServoControl(unsigned char axis, long pos, unsigned char home){  /* 100 Hz ***/
+    long togo;
+    unsigned char cap, homed = 0;
+    if (servo_state[axis] == SERVO_HOMING) {
+        if (home) {                     // Switch closed: the caller zeroes the position
+            servo_duty[axis] = 0;
+            servo_state[axis] = SERVO_IDLE;
+            homed = 1;
+        }
+        else if (!home_left[axis]--) {
+            servo_duty[axis] = 0;
+            servo_state[axis] = SERVO_IDLE;
+            servo_fault[axis] = SERVO_TIMEOUT;
+        }
+        else if (!Stalled(axis, pos)) Accelerate(axis);
+    }
+    else if (servo_state[axis] == SERVO_RUN) {
+        togo = servo_plus[axis] ? target[axis] - pos : pos - target[axis];
+        if (!servo_plus[axis] && home) {    // On the home switch: no further down
+            servo_duty[axis] = 0;
+            servo_state[axis] = SERVO_IDLE;
+        }
+        else if (togo <= servo_coast[axis] && ticks[axis] >= SERVO_RAMP) {  // Let it roll in
+            servo_duty[axis] = 0;
+            servo_state[axis] = SERVO_COAST;
+            learn[axis] = ticks[axis] >= SERVO_SETTLE;  // At speed: a coast worth learning
+            cut[axis] = pos;
+            ticks[axis] = 0;
+        }
+        else if (!Stalled(axis, pos)) {
+            Accelerate(axis);
+            togo -= servo_coast[axis];      // Deceleration: the duty falls with the distance
+            if (togo <= 0) cap = SERVO_MIN_DUTY;
+            else if (togo >= (SERVO_PWM - SERVO_MIN_DUTY) * SERVO_SLOPE) cap = SERVO_PWM;
+            else cap = SERVO_MIN_DUTY + (unsigned int)togo / SERVO_SLOPE;
+            if (servo_duty[axis] > cap) servo_duty[axis] = cap;
+        }
+    }
+    else if (servo_state[axis] == SERVO_COAST) {
+        if (pos != last[axis]) ticks[axis] = 0;     // Still rolling
+        else if (++ticks[axis] >= SERVO_SETTLE) {   // Stopped
+            if (learn[axis]) {              // A quarter of the way to this stop's coast
+                togo = servo_plus[axis] ? pos - cut[axis] : cut[axis] - pos;
+                servo_coast[axis] += ((int)togo - servo_coast[axis]) >> 2;
+                if (servo_coast[axis] < 0) servo_coast[axis] = 0;
+            }
+            togo = target[axis] - pos;
+            if ((togo > SERVO_BAND || togo < -SERVO_BAND) && tries[axis]) {
+                tries[axis]--;
+                Start(axis, pos);
+            }
+            else servo_state[axis] = SERVO_IDLE;
+        }
+    }
+    last[axis] = pos;
+    hal_cost(80);                       // Cycle model: 32-bit compares and the division
+    return homed;
+}
+
+unsigned char ServoPwm(){  /************************************ 1 kHz: PORTD motor bits ***/
+    unsigned char axis, out = 0;
+    if (++phase == SERVO_PWM) phase = 0;
+    for (axis = 0; axis < 2; axis++)
+        if (phase < servo_duty[axis])
+            out |= servo_plus[axis] ? DRIVE_PLUS(axis) : DRIVE_MINUS(axis);
+    return out;
+}
@@ -0,0 +1,64 @@
+/*********************************************************************************************/
+/* servo.h - closed-loop position control of the heliostat pan and tilt motors               */
+/* Positions are Hall pulses: pan_count x 100 + pan100. ServoMove() sets a target and the    */
+/* TMR0 interrupt does the rest:                                                             */
+/*                                                                                           */
+/*   ServoControl()  100 Hz, per axis: the motion profile, sets servo_duty and servo_plus    */
+/*   ServoPwm()      1 kHz: software PWM, SERVO_PWM steps, returns the PORTD drive bits      */
+/*                                                                                           */
+/* Profile: the duty starts at SERVO_MIN_DUTY and rises one step every SERVO_RAMP ticks      */
+/* (acceleration); near the target it is capped at SERVO_MIN_DUTY plus one step per          */
+/* SERVO_SLOPE pulses still to go (deceleration), so the motor arrives slowly. The drive is  */
+/* cut servo_coast pulses early: the distance the axis rolls on after power is cut, learned  */
+/* from every stop. After SERVO_SETTLE ticks without a pulse the axis has stopped; if it is  */
+/* more than SERVO_BAND pulses off, it tries again, up to SERVO_TRIES times.                 */
+/*                                                                                           */
+/* The Hall sensors give no direction: the pulse counter takes it from servo_plus, which     */
+/* keeps the last drive direction while the axis coasts. A closed home switch stops minus    */
+/* motion at once.                                                                           */
+/*                                                                                           */
+/* ServoHome() drives the axis minus until its home switch closes; ServoControl() returns 1  */
+/* on that tick so the caller can zero the position. Both axes home at the same time. An     */
+/* axis driven without a Hall pulse for SERVO_STALL ticks, or still homing after             */
+/* SERVO_HOME_TIME ticks, stops with servo_fault set.                                        */
+/* Update history: 10/17/2026 initiated                                                      */
+/*********************************************************************************************/
+#ifndef SERVO_H
+#define SERVO_H
+
+#define SERVO_PAN       0
+#define SERVO_TILT      1
+
+#define SERVO_PWM       16          // PWM steps per period: 62.5 Hz at a 1 kHz ServoPwm()
+#define SERVO_MIN_DUTY  4           // Lowest duty that still turns the motor
+#define SERVO_RAMP      3           // Ticks per duty step while accelerating
+#define SERVO_SLOPE     25          // Pulses to go per duty step while decelerating
+#define SERVO_BAND      50          // Pulses from the target that count as there
+#define SERVO_SETTLE    20          // Ticks without a Hall pulse: the axis has stopped
+#define SERVO_COAST0    30          // Coast before the first stop has been measured
+#define SERVO_TRIES     3           // Corrections after the first stop
+#define SERVO_STALL     50          // Ticks under power without a Hall pulse: stalled
+#define SERVO_HOME_TIME 12000       // Ticks to find the home switch, 2 minutes
+
+#define SERVO_IDLE      0           // servo_state: not driven
+#define SERVO_RUN       1           // driven toward the target
+#define SERVO_COAST     2           // power cut, waiting for the axis to stop
+#define SERVO_HOMING    3           // driven minus to the home switch
+
+#define SERVO_OK        0           // servo_fault: none since the last ServoMove/ServoHome
+#define SERVO_STALLED   1           // no Hall pulses under power
+#define SERVO_TIMEOUT   2           // home switch not found in time
+
+void ServoInit();
+void ServoMove(unsigned char axis, long target);    // Target in Hall pulses
+void ServoHome(unsigned char axis); // Find the home switch
+void ServoStop();                   // Both axes, power off at once
+unsigned char ServoBusy();          // Either axis not idle
+unsigned char ServoControl(unsigned char axis, long pos, unsigned char home);  // 1: homed
+unsigned char ServoPwm();           // 1 kHz, in isr(): RD4-RD7
+
+extern unsigned char servo_state[2], servo_duty[2], servo_fault[2];
+extern unsigned char servo_plus[2]; // Direction of the last drive, 1 = plus
+extern int servo_coast[2];          // Learned coast, pulses
+
+#endif
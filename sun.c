@@ -0,0 +1,124 @@
+/*********************************************************************************************/
+/* sun.c - solar position and heliostat mirror angles, see sun.h                             */
+/* Vectors are east, north, up in Q14. The sun is                                            */
+/*     E = -cos(dec) sin(H)                                                                  */
+/*     N =  sin(dec) cos(lat) - cos(dec) cos(H) sin(lat)                                     */
+/*     U =  sin(dec) sin(lat) + cos(dec) cos(H) cos(lat)                                     */
+/* for hour angle H, and the mirror normal is the sum of the sun and target unit vectors.    */
+/* Update history: 10/17/2026 initiated                                                      */
+/*********************************************************************************************/
+#include "hal.h"
+#include "sun.h"
+
+#define SUN_LON_S       ((SUN_LON - 1500L * SUN_TZ) * 12 / 5)   // Seconds east of the zone
+
+unsigned short sun_az, sun_el, mirror_az, mirror_el;
+unsigned char sun_up;
+int pan_target, tilt_target;
+
+static const short sine[65] = {     // sin(k x 90 / 64 degrees), Q14
+    0, 402, 804, 1205, 1606, 2006, 2404, 2801, 3196, 3590, 3981, 4370, 4756, 5139, 5520, 5897,
+    6270, 6639, 7005, 7366, 7723, 8076, 8423, 8765, 9102, 9434, 9760, 10080, 10394, 10702,
+    11003, 11297, 11585, 11866, 12140, 12406, 12665, 12916, 13160, 13395, 13623, 13842, 14053,
+    14256, 14449, 14635, 14811, 14978, 15137, 15286, 15426, 15557, 15679, 15791, 15893, 15986,
+    16069, 16143, 16207, 16261, 16305, 16340, 16364, 16379, 16384 };
+static const unsigned short arctan[14] = {    // atan(2^-i), binary angle
+    8192, 4836, 2555, 1297, 651, 326, 163, 81, 41, 20, 10, 5, 3, 1 };
+
+short SunSin(unsigned short a){  /************************ Table with linear interpolation ***/
+    unsigned short x;
+    unsigned char i;
+    short y;
+    x = a & 0x3FFF;                     // Angle within the quadrant
+    if (a & 0x4000) x = 0x4000 - x;     // 2nd and 4th: mirrored
+    i = x >> 8;
+    if (i == 64) y = sine[64];
+    else y = sine[i] + (short)(((long)(sine[i + 1] - sine[i]) * (x & 0xFF)) >> 8);
+    return a & 0x8000 ? -y : y;         // 3rd and 4th: negative
+}
+
+short SunCos(unsigned short a){
+    return SunSin(a + 0x4000);
+}
+
+unsigned short SunAtan2(long y, long x){  /************* CORDIC vectoring, |x|, |y| < 2^22 ***/
+    unsigned short a = 0;
+    unsigned char i;
+    long t;
+    if (x < 0) {                        // Left half: turn by 180 degrees first
+        x = -x;
+        y = -y;
+        a = 0x8000;
+    }
+    x <<= 8;                            // Q14 to Q22: resolution for the small steps
+    y <<= 8;
+    for (i = 0; i < 14; i++) {          // Rotate (x, y) onto the x axis
+        t = x;
+        if (y > 0) {
+            x += y >> i;
+            y -= t >> i;
+            a += arctan[i];
+        }
+        else {
+            x -= y >> i;
+            y += t >> i;
+            a -= arctan[i];
+        }
+    }
+    return a;
+}
+
+static unsigned int Isqrt(unsigned long v){  /**************************** Bit by bit ********/
+    unsigned long r = 0, b = 1UL << 30;
+    while (b > v) b >>= 2;
+    while (b) {
+        if (v >= r + b) {
+            v -= r + b;
+            r = (r >> 1) + b;
+        }
+        else r >>= 1;
+        b >>= 2;
+    }
+    return r;
+}
+
+static unsigned short Elevation(long e, long n, long u){  /**** Above the horizontal plane ***/
+    return SunAtan2(u, Isqrt(e * e + n * n));
+}
+
+void SunUpdate(int day, unsigned char hr, unsigned char min, unsigned char sec){  /***********/
+    unsigned short g, dec, h;
+    long acc, t, sd, cd, ch, slat, clat, e, n, u, te, tn, tu;
+    g = ((long)(day - 1) * 24 + hr - 12) * 65536L / 8760;  // Fractional year
+    acc = 1155L * 16384                 // Declination x 16, Spencer
+          - 66740L * SunCos(g) + 11725L * SunSin(g)
+          - 1128L * SunCos(2 * g) + 151L * SunSin(2 * g)
+          - 450L * SunCos(3 * g) + 247L * SunSin(3 * g);
+    dec = acc >> 18;
+    acc = 4L * 16384                    // Equation of time x 4 s
+          + 103L * SunCos(g) - 1764L * SunSin(g)
+          - 804L * SunCos(2 * g) - 2247L * SunSin(2 * g);
+    t = hr * 3600L + min * 60 + sec + SUN_LON_S + (acc >> 16) - 43200;   // Solar, from noon
+    h = t * 512 / 675;                  // Hour angle: 86400 s = 65536
+    sd = SunSin(dec);   cd = SunCos(dec);
+    slat = SunSin(SUN_ANGLE(SUN_LAT));  clat = SunCos(SUN_ANGLE(SUN_LAT));
+    ch = cd * SunCos(h) >> 14;          // cos(dec) cos(H)
+    e = -(cd * SunSin(h) >> 14);
+    n = (sd * clat - ch * slat) >> 14;
+    u = (sd * slat + ch * clat) >> 14;
+    sun_az = SunAtan2(e, n);
+    sun_el = Elevation(e, n, u);
+    sun_up = (short)sun_el > 0;
+    t = SunCos(SUN_ANGLE(TARGET_EL));   // Target direction
+    te = t * SunSin(SUN_ANGLE(TARGET_AZ)) >> 14;
+    tn = t * SunCos(SUN_ANGLE(TARGET_AZ)) >> 14;
+    tu = SunSin(SUN_ANGLE(TARGET_EL));
+    e = (e + te) >> 1;                  // Bisector, half length: squares stay under 2^30
+    n = (n + tn) >> 1;
+    u = (u + tu) >> 1;
+    mirror_az = SunAtan2(e, n);
+    mirror_el = Elevation(e, n, u);
+    pan_target = (short)(mirror_az - SUN_ANGLE(PAN_AZ0)) * (long)PAN_TURN >> 16;
+    tilt_target = (short)(mirror_el - SUN_ANGLE(TILT_EL0)) * (long)TILT_TURN >> 16;
+    hal_cost(6000);                     // Cycle model: 20 table lookups, 3 CORDIC, 2 sqrt
+}
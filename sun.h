@@ -0,0 +1,67 @@
+/*********************************************************************************************/
+/* sun.h - solar position and heliostat mirror angles, fixed point                           */
+/* SunUpdate() takes the day of the year (1 = January 1) and the clock time of               */
+/* Heliostat1_N.c and finds:                                                                 */
+/*                                                                                           */
+/*   sun_az, sun_el          where the sun is                                                */
+/*   mirror_az, mirror_el    where the mirror normal must point: half way between the sun    */
+/*                           and the target, so the reflection lands on the target           */
+/*   pan_target, tilt_target the same as pan_count / tilt_count encoder values               */
+/*                                                                                           */
+/* Angles are binary: 65536 = 360 degrees, so they wrap like the angle and a signed 16-bit   */
+/* difference is the shortest way round. Azimuth is from north toward east, elevation from   */
+/* the horizon. Declination and equation of time are Spencer's Fourier series (about 0.05    */
+/* degree and 30 s); sin/cos are a 65-point quarter-wave table with interpolation, atan2 is  */
+/* CORDIC and the only divisions are two per update: about 6 ms at 4 MHz, no math.h.         */
+/*                                                                                           */
+/* The clock is local standard time (no daylight saving) of time zone SUN_TZ. The mount is   */
+/* altitude-azimuth: pan turns about the vertical, tilt about the horizontal; PAN_AZ0 and    */
+/* TILT_EL0 are the mirror normal at the home position (counts 0) and PAN_TURN / TILT_TURN   */
+/* the counts (100 Hall pulses each) of one turn of the axis. Override any of them in the    */
+/* project settings.                                                                         */
+/* Update history: 10/17/2026 initiated                                                      */
+/*********************************************************************************************/
+#ifndef SUN_H
+#define SUN_H
+
+#ifndef SUN_LAT
+#define SUN_LAT         4148        // Latitude, 1/100 degree, north + (Kingston, RI)
+#endif
+#ifndef SUN_LON
+#define SUN_LON         (-7153)     // Longitude, 1/100 degree, east +
+#endif
+#ifndef SUN_TZ
+#define SUN_TZ          (-5)        // Hours from UTC of the clock, EST
+#endif
+#ifndef TARGET_AZ
+#define TARGET_AZ       0           // Target seen from the mirror: azimuth, 1/100 degree
+#endif
+#ifndef TARGET_EL
+#define TARGET_EL       0           // and elevation
+#endif
+#ifndef PAN_AZ0
+#define PAN_AZ0         18000       // Azimuth of the mirror normal at pan_count 0
+#endif
+#ifndef TILT_EL0
+#define TILT_EL0        0           // Elevation of the mirror normal at tilt_count 0
+#endif
+#ifndef PAN_TURN
+#define PAN_TURN        360         // pan_count per turn of the pan axis
+#endif
+#ifndef TILT_TURN
+#define TILT_TURN       360         // tilt_count per turn of the tilt axis
+#endif
+
+#define SUN_ANGLE(cdeg) ((unsigned short)((cdeg) * 65536L / 36000))  // 1/100 degree to binary
+#define SUN_CDEG(a)     ((int)((short)(a) * 36000L >> 16))          // and back, signed
+
+void SunUpdate(int day, unsigned char hr, unsigned char min, unsigned char sec);
+short SunSin(unsigned short a);     // Q14: 16384 = 1.0
+short SunCos(unsigned short a);
+unsigned short SunAtan2(long y, long x);
+
+extern unsigned short sun_az, sun_el, mirror_az, mirror_el;
+extern unsigned char sun_up;        // Sun above the horizon
+extern int pan_target, tilt_target; // Encoder counts for mirror_az, mirror_el
+
+#endif
@@ -0,0 +1,54 @@
+/*********************************************************************************************/
+/* timebase.c - monotonic microsecond time from TMR3, see timebase.h                         */
+/* The high word and TMR3 are read as a pair, again if isr() counted an overflow between    */
+/* them; an overflow isr() has not counted yet is added when TMR3 has only just wrapped.     */
+/* Update history: 10/17/2026 initiated                                                      */
+/*********************************************************************************************/
+#include "hal.h"
+#include "timebase.h"
+
+static volatile unsigned short time_hi;     // TMR3 overflows
+
+void TimeStart(){
+    time_hi = 0;
+    hal_tmr3_start(TIME_T3PS);
+    hal_tmr3_ack();
+    hal_tmr3_irq(1);                // Peripheral interrupt: PEIE must be on
+}
+
+unsigned long TimeUs(){  /****************************************** Microseconds, 32 bits ***/
+    unsigned short hi, lo;
+    unsigned char wrapped;
+    do {
+        hi = time_hi;
+        lo = hal_tmr3_read();
+        wrapped = hal_tmr3_pending();
+    } while (hi != time_hi);
+    if (wrapped && lo < 0x8000) hi++;   // Wrapped before lo was read, not counted yet
+    return (unsigned long)hi << 16 | lo;
+}
+
+unsigned long TimeAfter(unsigned long us){
+    return TimeUs() + us;
+}
+
+unsigned char TimeUp(unsigned long deadline){
+    return (long)(TimeUs() - deadline) >= 0;
+}
+
+void DelayUs(unsigned long us){  /*********************** Wait, main() only, interrupts on ***/
+    unsigned long deadline;
+    deadline = TimeAfter(us);
+    while (!TimeUp(deadline)) hal_spin();
+}
+
+void DelayMs(unsigned int ms){
+    DelayUs(TIME_MS(ms));
+}
+
+void TimeService(){  /****************************************** TMR3 overflow, from isr() ***/
+    if (hal_tmr3_pending()) {
+        hal_tmr3_ack();
+        time_hi++;
+    }
+}
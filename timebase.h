@@ -0,0 +1,45 @@
+/*********************************************************************************************/
+/* timebase.h - monotonic microsecond time from TMR3, delays and deadlines                   */
+/* TMR3 counts microseconds (instruction cycles through the prescaler that makes them 1 us)  */
+/* and its overflow, every 65.5 ms, carries into a high word in isr(): TimeUs() is 32 bits   */
+/* of microseconds since TimeStart(), wrapping after 71 minutes. Times are compared by       */
+/* difference only, so a deadline may lie up to 35 minutes ahead.                            */
+/*                                                                                           */
+/*   TimeAfter(us)      the deadline us from now                                             */
+/*   TimeUp(deadline)   1 once it has passed: a timeout a task tests without waiting         */
+/*   DelayUs(us)        wait, main() only                                                    */
+/*   DelayMs(ms)        wait, main() only                                                    */
+/*                                                                                           */
+/* The delays replace the old Delay_ms() loop, whose length depended on the compiler and on  */
+/* the interrupts taken meanwhile. They hold interrupts on: isr() must call TimeService(),   */
+/* and isr() itself sees at most one uncounted overflow, so it must not wait on the time.    */
+/* Update history: 10/17/2026 initiated                                                      */
+/*********************************************************************************************/
+#ifndef TIMEBASE_H
+#define TIMEBASE_H
+
+#include "rate.h"
+
+#if RATE_FCY == 1000000
+#define TIME_T3PS       0           // TMR3 prescaler 1:1 at 4 MHz
+#elif RATE_FCY == 2000000
+#define TIME_T3PS       1           // 1:2
+#elif RATE_FCY == 4000000
+#define TIME_T3PS       2           // 1:4
+#elif RATE_FCY == 8000000
+#define TIME_T3PS       3           // 1:8
+#else
+#error "timebase.h: TMR3 cannot count microseconds at this _XTAL_FREQ"
+#endif
+
+#define TIME_MS(ms)     ((ms) * 1000UL)
+
+void TimeStart();                   // TMR3 and its interrupt on, time 0
+unsigned long TimeUs();
+unsigned long TimeAfter(unsigned long us);
+unsigned char TimeUp(unsigned long deadline);
+void DelayUs(unsigned long us);
+void DelayMs(unsigned int ms);
+void TimeService();                 // Count TMR3 overflows, call from isr()
+
+#endif
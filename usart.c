@@ -0,0 +1,136 @@
+/*********************************************************************************************/
+/* usart.c - interrupt-driven USART transmit queues shared by the LCD and Bluetooth paths    */
+/* Transmit() and TransmitBT() only enqueue. TXIF drains the Bluetooth queue back to back;   */
+/* the LCD queue is paced by TMR2, which ticks every 1 ms and lets one byte out every        */
+/* LCD_GAP ticks, replacing the old busy-wait + Delay_ms(4) per byte. When the LCD queue is  */
+/* empty the same tick sends the frame buffer of lcd.c, one changed cell at a time.          */
+/* Once RxStart() is called RCIF moves every received byte into a ring for main(): the       */
+/* 2-byte USART FIFO alone overflows whenever main() is late by more than two bytes.         */
+/* Update history: 10/17/2026 initiated                                                      */
+/*********************************************************************************************/
+#include "hal.h"
+#include "usart.h"
+#include "lcd.h"
+
+static unsigned char lcd_q[LCD_QSIZE], bt_q[BT_QSIZE];
+static volatile unsigned char lcd_head, lcd_tail, bt_head, bt_tail;
+static volatile unsigned int lcd_gap;   // TMR2 ticks left before the next LCD byte may go
+static unsigned char rx_q[RX_QSIZE];
+static volatile unsigned char rx_head, rx_tail;
+unsigned char tx_drops, rx_drops;
+
+void SetupSerial(){  /*********** Set up the USART Asynchronous Transmit (pin 25) ************/
+// For LCD - use SPBRG = 25;  9600 BAUD at 4MHz: 4,000,000/(16x9600) - 1 = 25.04
+// For Bluetooth - use SPBRG = 1; 115200 BAUD at 4MHz: 4,000,000/(16x115200) - 1 = 1
+    hal_port_dir(C, 0x80);			// Transmit and receive, 0xC0 if transmit only
+    hal_uart_init(25);				// 9600 baud, asynchronous, TX + continuous RX, BRGH
+    hal_tmr2_start(0b00000101, 249);	// TMR2 on, 1:4 x 250 = 1 ms LCD pacing tick at 4 MHz
+    TxFlush();
+    hal_irq_peripherals();          // Peripheral interrupts (TXIE, TMR2IE) on
+}
+
+void TxFlush(){  /************* Drop queued bytes, e.g. before changing the baud rate *************/
+    hal_uart_tx_irq(0);
+    hal_tmr2_irq(0);
+    lcd_head = lcd_tail = bt_head = bt_tail = 0;
+    lcd_gap = 0;
+}
+
+void TxPause(unsigned int ms){  /******* Hold the LCD queue for ms without blocking **********/
+    hal_tmr2_irq(0);                // lcd_gap is 16-bit, keep TxService() off it meanwhile
+    lcd_gap = ms;
+    hal_tmr2_irq(1);                // TMR2 counts the pause down
+}
+
+void Transmit(unsigned char value) {  /********** queue an ASCII Character for the LCD ********/
+    unsigned char next;
+    next = (lcd_head + 1) & (LCD_QSIZE - 1);
+    while (next == lcd_tail) hal_spin();	// Wait until TMR2 has made room (never call with GIE off)
+    lcd_q[lcd_head] = value;
+    lcd_head = next;
+    hal_tmr2_irq(1);                // TMR2 lets it out after the current gap
+}
+
+void TransmitBT(unsigned char value) {  /****** queue a byte for Bluetooth, drop if full *******/
+    unsigned char next;
+    next = (bt_head + 1) & (BT_QSIZE - 1);
+    if (next == bt_tail) {          // Never wait here, we may be inside isr()
+        tx_drops++;
+        return;
+    }
+    bt_q[bt_head] = value;
+    bt_head = next;
+    hal_uart_tx_irq(1);             // TXIF pulls it out as soon as TXREG is empty
+}
+
+unsigned char TxBTFree() {  /************ Room left in the Bluetooth queue ********************/
+    return (bt_tail - bt_head - 1) & (BT_QSIZE - 1);
+}
+
+void TxService() { /******************* Drain the transmit queues, called from isr() ***********/
+    unsigned char c;
+    if (hal_tmr2_irq_on() && hal_tmr2_pending()) {  // 1 ms LCD pacing tick
+        hal_tmr2_ack();
+        if (lcd_gap) lcd_gap--;
+        else if (lcd_tail != lcd_head) {
+            if (hal_uart_tx_ready() && bt_tail == bt_head) {    // TXREG free, no Bluetooth burst
+                hal_uart_put(lcd_q[lcd_tail]);
+                lcd_tail = (lcd_tail + 1) & (LCD_QSIZE - 1);
+                lcd_gap = LCD_GAP;  // ~1 ms on the wire at 9600 + 3-4 ms gap, as Delay_ms(4) did
+            }
+        }
+        else if (hal_uart_tx_ready() && bt_tail == bt_head) {
+            if (LcdNext(&c)) {      // Queue empty: the next changed cell of the frame buffer
+                hal_uart_put(c);
+                lcd_gap = LCD_GAP;
+            }
+            else hal_tmr2_irq(0);   // Display in sync: nothing left to pace
+        }                           // TXREG or a Bluetooth burst busy: again on the next tick
+    }
+    if (hal_uart_tx_irq_on() && hal_uart_tx_ready()) {  // TXREG empty
+        if (bt_tail != bt_head) {
+            hal_uart_put(bt_q[bt_tail]);
+            bt_tail = (bt_tail + 1) & (BT_QSIZE - 1);
+        }
+        else hal_uart_tx_irq(0);    // Queue empty, stop TXIF from retriggering
+    }
+}
+
+void RxStart() { /********************* Empty the receive ring, receive by interrupt ************/
+    hal_uart_rx_irq(0);
+    rx_head = rx_tail = 0;
+    if (hal_uart_rx_overrun()) hal_uart_rx_restart();
+    hal_uart_rx_irq(1);             // Peripheral interrupts must be on, see SetupSerial()
+}
+
+unsigned char RxReady() {  /************* Bytes waiting in the receive ring *******************/
+    return (rx_head - rx_tail) & (RX_QSIZE - 1);
+}
+
+unsigned char RxGet() {  /*************** Take the oldest byte out of the receive ring *********/
+    unsigned char value;
+    value = rx_q[rx_tail];
+    rx_tail = (rx_tail + 1) & (RX_QSIZE - 1);
+    return value;
+}
+
+unsigned char RxService() { /********** Fill the receive ring, called from isr(): bytes added ***/
+    unsigned char next, n = 0;
+    if (hal_uart_rx_overrun()) {    // FIFO overflowed: the USART receives nothing until reset
+        hal_uart_rx_restart();
+        rx_drops++;
+    }
+    while (hal_uart_rx_ready()) {   // Reading RCREG clears RCIF
+        next = (rx_head + 1) & (RX_QSIZE - 1);
+        if (next == rx_tail) {      // main() is behind: drop the newest
+            hal_uart_get();
+            rx_drops++;
+        }
+        else {
+            rx_q[rx_head] = hal_uart_get();
+            rx_head = next;
+            n++;
+        }
+    }
+    return n;
+}
@@ -0,0 +1,29 @@
+/*********************************************************************************************/
+/* usart.h - interrupt-driven USART transmit queues shared by the LCD and Bluetooth paths,   */
+/* and the receive ring                                                                      */
+/* Update history: 10/17/2026 initiated                                                      */
+/*********************************************************************************************/
+#ifndef USART_H
+#define USART_H
+
+#define LCD_QSIZE   32          // LCD queue length, must be a power of 2
+#define BT_QSIZE    64          // Bluetooth queue length, must be a power of 2
+#define RX_QSIZE    32          // Receive ring length, must be a power of 2
+#define LCD_GAP     4           // TMR2 ticks (1 ms) to wait after each byte sent to the LCD
+
+void SetupSerial();
+void Transmit(unsigned char value);     // LCD path: queued, one byte per LCD_GAP ms
+void TransmitBT(unsigned char value);   // Bluetooth path: queued back to back, never blocks
+void TxPause(unsigned int ms);          // Hold the LCD queue for ms (e.g. while LCD boots)
+void TxFlush();                         // Drop everything queued (baud rate change)
+unsigned char TxBTFree();               // Room left in the Bluetooth queue
+void TxService();                       // Drain the queues, call from isr()
+void RxStart();                         // Receive into the ring from now on (RCIE)
+unsigned char RxReady();                // Bytes waiting in the receive ring
+unsigned char RxGet();                  // Oldest received byte, call only when RxReady()
+unsigned char RxService();              // Fill the receive ring, call from isr(): bytes added
+
+extern unsigned char tx_drops;          // Bluetooth bytes dropped because the queue was full
+extern unsigned char rx_drops;          // Received bytes lost: ring full or USART overrun
+
+#endif